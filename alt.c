@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "alt.h"
+#include "stats.h"
+
+/* Helper function which copies one landmark's distances into column i of a
+	vertex-major table
+**************************************************************************/
+static void store_column(Landmarks *self, int *table, int i, int *distance) {
+	for (int v = 0; v < self->V; v++) {
+		table[(size_t)v * self->count + i] = distance[v];
+	}
+}
+
+/* Helper function which returns the vertex at position p round the border of a
+	side x side grid, clockwise from vertex 0 (vertex = x * side + y, as build_graph())
+**************************************************************************/
+static int border_vertex(int side, int p) {
+	int edge = side - 1;
+	if (p < edge) {
+		return p;										// Top row, left to right
+	}
+	if (p < 2 * edge) {
+		return (p - edge) * side + edge;				// Right column, downwards
+	}
+	if (p < 3 * edge) {
+		return edge * side + (3 * edge - p);			// Bottom row, right to left
+	}
+	return (4 * edge - p) * side;						// Left column, upwards
+}
+
+/* Builds landmark distance tables for graph
+	Takes graph (non-negative weights), number of landmarks, how to select them and thread
+	count (<= 0 uses every available core)
+
+	LANDMARKS_FARTHEST starts from the vertex farthest from vertex 0, then repeatedly adds
+	the vertex whose nearest landmark is farthest away; each choice needs the previous
+	landmark's distances, so these searches run one at a time. LANDMARKS_CORNERS needs a
+	square graph (a DEM) and falls back to LANDMARKS_FARTHEST otherwise. Searches towards
+	each landmark (on the reversed graph) run across threads.
+*********************************************************************************************/
+Landmarks build_landmarks(CsrGraph *graph, int count, LandmarkSelection selection, int threads) {
+
+	Landmarks self;
+	int vertexCount = graph->V;
+	count = count > vertexCount ? vertexCount : count;
+	count = count < 1 ? 1 : count;
+
+	self.V = vertexCount;
+	self.count = count;
+	self.vertex = malloc(count * sizeof(int));
+	self.from = malloc((size_t)vertexCount * count * sizeof(int));
+	self.to = malloc((size_t)vertexCount * count * sizeof(int));
+
+#ifdef _OPENMP
+	if (threads <= 0) threads = omp_get_max_threads();
+#else
+	threads = 1;
+#endif
+	STATS_PARENT(parent);
+
+	int side = 1;
+	while ((long long)(side + 1) * (side + 1) <= vertexCount) {
+		side++;
+	}
+	if (selection == LANDMARKS_CORNERS && side > 1 && side * side == vertexCount) {
+		for (int i = 0; i < count; i++) {
+			self.vertex[i] = border_vertex(side, (int)((long long)i * 4 * (side - 1) / count));
+		}
+
+		#pragma omp parallel num_threads(threads)
+		{
+			STATS_WORKER_BEGIN(parent);
+			int *distance = malloc(vertexCount * sizeof(int));
+			int *previous = malloc(vertexCount * sizeof(int));
+
+			#pragma omp for schedule(dynamic, 1)
+			for (int i = 0; i < count; i++) {
+				dijkstra_csr(graph, self.vertex[i], distance, previous);
+				store_column(&self, self.from, i, distance);
+			}
+
+			free(distance);
+			free(previous);
+			STATS_WORKER_END(parent);
+		}
+	}
+	else {
+		int *distance = malloc(vertexCount * sizeof(int));
+		int *previous = malloc(vertexCount * sizeof(int));
+		int *nearest = malloc(vertexCount * sizeof(int));	// Distance from nearest landmark so far
+
+		dijkstra_csr(graph, 0, distance, previous);
+		for (int v = 0; v < vertexCount; v++) {
+			nearest[v] = distance[v];
+		}
+		for (int i = 0; i < count; i++) {
+			int best = 0;
+			for (int v = 1; v < vertexCount; v++) {
+				if (nearest[v] != INT_MAX && (nearest[best] == INT_MAX || nearest[v] > nearest[best])) {
+					best = v;
+				}
+			}
+			self.vertex[i] = best;
+			dijkstra_csr(graph, best, distance, previous);
+			store_column(&self, self.from, i, distance);
+			for (int v = 0; v < vertexCount; v++) {
+				nearest[v] = i == 0 || distance[v] < nearest[v] ? distance[v] : nearest[v];
+			}
+		}
+
+		free(distance);
+		free(previous);
+		free(nearest);
+	}
+
+	CsrGraph reverse = csr_transpose(graph);
+
+	#pragma omp parallel num_threads(threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+		int *distance = malloc(vertexCount * sizeof(int));
+		int *previous = malloc(vertexCount * sizeof(int));
+
+		#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < count; i++) {
+			dijkstra_csr(&reverse, self.vertex[i], distance, previous);
+			store_column(&self, self.to, i, distance);
+		}
+
+		free(distance);
+		free(previous);
+		STATS_WORKER_END(parent);
+	}
+
+	destroy_csr_graph(&reverse);
+	return self;
+}
+
+/* Destroys landmarks, freeing all memory
+******************************************/
+void destroy_landmarks(Landmarks *self) {
+	free(self->vertex);
+	free(self->from);
+	free(self->to);
+	self->vertex = NULL;
+	self->from = NULL;
+	self->to = NULL;
+}
+
+/* Builds an ALT heuristic towards target
+******************************************/
+AltHeuristic alt_heuristic(Landmarks *self, int target) {
+	AltHeuristic h;
+	h.landmarks = self;
+	h.target = target;
+	return h;
+}
+
+/* Heuristic function; context is an AltHeuristic
+	Returns the largest triangle inequality bound on d(vertex, target) over all landmarks.
+	Landmarks which cannot reach (or be reached from) either vertex give no bound.
+*********************************************************************************************/
+int alt_lower_bound(int vertex, void *context) {
+
+	AltHeuristic *h = context;
+	int count = h->landmarks->count;
+	int *fromVertex = h->landmarks->from + (size_t)vertex * count;
+	int *fromTarget = h->landmarks->from + (size_t)h->target * count;
+	int *toVertex = h->landmarks->to + (size_t)vertex * count;
+	int *toTarget = h->landmarks->to + (size_t)h->target * count;
+	int bound = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (fromVertex[i] != INT_MAX && fromTarget[i] != INT_MAX && fromTarget[i] - fromVertex[i] > bound) {
+			bound = fromTarget[i] - fromVertex[i];		// d(L,t) <= d(L,v) + d(v,t)
+		}
+		if (toVertex[i] != INT_MAX && toTarget[i] != INT_MAX && toVertex[i] - toTarget[i] > bound) {
+			bound = toVertex[i] - toTarget[i];			// d(v,L) <= d(v,t) + d(t,L)
+		}
+	}
+	return bound;
+}
+
+/* A* over a CSR graph guided by landmarks; stops once target is settled
+	Same contract as dijkstra_csr_target(); landmarks must be built from this graph
+	and its current weights
+*********************************************************************************************/
+int alt_query(CsrGraph *graph, Landmarks *landmarks, int source, int target, int *distance, int *previous) {
+	AltHeuristic h = alt_heuristic(landmarks, target);
+	return astar_csr(graph, source, target, alt_lower_bound, &h, distance, previous);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "graph.h"
+
+// How build_landmarks() chooses landmark vertices
+typedef enum landmarkSelection {
+	LANDMARKS_FARTHEST,		// Each landmark is the vertex farthest from those already chosen
+	LANDMARKS_CORNERS		// Spread evenly round the border of a square DEM, starting at corners
+} LandmarkSelection;
+
+/* Landmark distances for ALT (A*, Landmarks, Triangle inequality) searches.
+	For each landmark L, from[] holds d(L, v) and to[] holds d(v, L) for every vertex v.
+	The triangle inequality then bounds d(v, t) from below by d(L, t) - d(L, v) and by
+	d(v, L) - d(t, L); alt_lower_bound() takes the largest bound over all landmarks.
+
+	Both tables are stored vertex-major (entry v * count + i for landmark i), so one
+	heuristic call reads two short contiguous runs. Weights must be non-negative.
+**************************************************************************/
+typedef struct landmarks {
+	int V;
+	int count;
+	int *vertex;		// count landmark vertices
+	int *from;			// V x count: d(landmark, v), INT_MAX if unreachable
+	int *to;			// V x count: d(v, landmark), INT_MAX if unreachable
+} Landmarks;
+
+/* ALT heuristic towards one target (usable as a Heuristic in graph.h)
+**************************************************************************/
+typedef struct altHeuristic {
+	Landmarks *landmarks;
+	int target;
+} AltHeuristic;
+
+// Functions for building/destroying landmarks
+Landmarks build_landmarks(CsrGraph *graph, int count, LandmarkSelection selection, int threads);
+void destroy_landmarks(Landmarks *self);
+
+// Heuristics
+AltHeuristic alt_heuristic(Landmarks *self, int target);
+int alt_lower_bound(int vertex, void *context);
+
+// Point-to-point query; returns distance to target (INT_MAX if unreachable)
+int alt_query(CsrGraph *graph, Landmarks *landmarks, int source, int target, int* distance, int* previous);
@@ -0,0 +1,307 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include "apstore.h"
+#include "johnson.h"
+
+#define NO_PATH (INT_MAX / 2)
+
+/* Row layout helpers
+	A row is: next-vertex codes (codeBits each, plus 4 bytes of padding so any code can
+	be read as one 32-bit window), then one uint32 offset per block of distances, then
+	the distances as zigzag varints
+**************************************************************************/
+static size_t code_bytes(AllPairsStore *self) {
+	return ((size_t)self->V * self->codeBits + 7) / 8 + 4;
+}
+
+static int block_count(AllPairsStore *self) {
+	return (self->V + AP_BLOCK - 1) / AP_BLOCK;
+}
+
+static size_t put_varint(unsigned char *out, uint32_t value) {
+	size_t n = 0;
+	while (value >= 0x80) {
+		out[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (unsigned char)value;
+	return n;
+}
+
+static uint32_t zigzag(int delta) {
+	return delta < 0 ? ((uint32_t)(-(delta + 1)) << 1) | 1 : (uint32_t)delta << 1;
+}
+
+/* Helper function which compresses rows first .. first + count - 1
+	Returns tile bytes (caller frees), and sets *bytes to its size
+**************************************************************************/
+static unsigned char *compress_tile(AllPairsStore *self, int first, int count, int *distance, int *next, size_t *bytes) {
+
+	CsrGraph *graph = self->graph;
+	int vertexCount = self->V;
+	size_t codes = code_bytes(self);
+	int blocks = block_count(self);
+	size_t rowMax = codes + blocks * sizeof(uint32_t) + (size_t)vertexCount * 5;
+	size_t header = (count + 1) * sizeof(uint32_t);
+	unsigned char *out = malloc(header + count * rowMax);
+	size_t n = header;
+
+	for (int r = 0; r < count; r++) {
+		int source = first + r;
+		int *distRow = distance + (size_t)r * vertexCount;
+		int *nextRow = next + (size_t)r * vertexCount;
+		uint32_t rowOffset = (uint32_t)n;
+		memcpy(out + r * sizeof(uint32_t), &rowOffset, sizeof rowOffset);
+
+		unsigned char *code = out + n;
+		memset(code, 0, codes);
+		for (int j = 0; j < vertexCount; j++) {
+			if (nextRow[j] == -1) {
+				continue;							// Distance says there is no path
+			}
+			uint32_t k = 0;
+			while (graph->to_vertex[graph->offsets[source] + k] != nextRow[j]) {
+				k++;
+			}
+			size_t bit = (size_t)j * self->codeBits;
+			for (int b = 0; b < self->codeBits; b++, bit++) {
+				code[bit / 8] |= ((k >> b) & 1) << (bit % 8);
+			}
+		}
+		n += codes;
+
+		unsigned char *check = out + n;
+		n += blocks * sizeof(uint32_t);
+		size_t streamStart = n;
+		int last = 0;
+		for (int j = 0; j < vertexCount; j++) {
+			if (j % AP_BLOCK == 0) {
+				uint32_t offset = (uint32_t)(n - streamStart);
+				memcpy(check + (j / AP_BLOCK) * sizeof(uint32_t), &offset, sizeof offset);
+				last = 0;
+			}
+			n += put_varint(out + n, zigzag(distRow[j] - last));
+			last = distRow[j];
+		}
+	}
+	uint32_t end = (uint32_t)n;
+	memcpy(out + count * sizeof(uint32_t), &end, sizeof end);
+
+	*bytes = n;
+	return realloc(out, n);
+}
+
+/* Helper function which maps (or reads) the spill file once every tile is written
+	Returns 1 on success, 0 on failure
+**************************************************************************/
+static int map_spill(AllPairsStore *self) {
+
+	if (fflush(self->spill) != 0) {
+		return 0;
+	}
+#ifndef _WIN32
+	void *data = mmap(NULL, self->fileBytes, PROT_READ, MAP_SHARED, fileno(self->spill), 0);
+	if (data != MAP_FAILED) {
+		fclose(self->spill);						// Mapping stays valid after close
+		self->spill = NULL;
+		self->map = data;
+		self->mapped = 1;
+		return 1;
+	}
+#endif
+	self->map = malloc(self->fileBytes);				// No mmap: read file instead
+	rewind(self->spill);
+	int ok = self->map != NULL && fread(self->map, 1, self->fileBytes, self->spill) == self->fileBytes;
+	fclose(self->spill);
+	self->spill = NULL;
+	self->mapped = 0;
+	return ok;
+}
+
+/* Builds compressed all-pairs tables for graph
+	Takes graph (may contain negative edges; must outlive the store), bytes of tiles to
+	keep in memory, path of a spill file for the rest (NULL keeps everything in memory),
+	and thread count (<= 0 uses every available core)
+
+	Rows are computed AP_TILE_ROWS at a time with johnson_rows(), so only one tile of
+	uncompressed rows exists at once; the |V|x|V| tables are never allocated.
+	Returns 1 on success, or 0 if the graph has a negative cycle or the spill file
+	cannot be written ('out' is left empty)
+*********************************************************************************************/
+int ap_store_build(CsrGraph *graph, size_t budget, const char *spillPath, int threads, AllPairsStore *out) {
+
+	memset(out, 0, sizeof *out);
+
+	JohnsonGraph reweighted;
+	if (!johnson_prepare(graph, &reweighted)) {
+		return 0;
+	}
+	CsrGraph reverse = csr_transpose(&reweighted.graph);
+
+	int vertexCount = graph->V;
+	int maxDegree = 1;
+	for (int v = 0; v < vertexCount; v++) {
+		int degree = graph->offsets[v + 1] - graph->offsets[v];
+		maxDegree = degree > maxDegree ? degree : maxDegree;
+	}
+
+	out->graph = graph;
+	out->V = vertexCount;
+	out->codeBits = 1;
+	while ((1 << out->codeBits) < maxDegree) {
+		out->codeBits++;
+	}
+	out->tileCount = (vertexCount + AP_TILE_ROWS - 1) / AP_TILE_ROWS;
+	out->tiles = calloc((unsigned)out->tileCount, sizeof(ApTile));
+	out->budget = budget;
+
+	int *distance = malloc((size_t)AP_TILE_ROWS * vertexCount * sizeof(int));
+	int *next = malloc((size_t)AP_TILE_ROWS * vertexCount * sizeof(int));
+	int ok = 1;
+
+	for (int t = 0; t < out->tileCount && ok; t++) {
+		int first = t * AP_TILE_ROWS;
+		int count = vertexCount - first < AP_TILE_ROWS ? vertexCount - first : AP_TILE_ROWS;
+		johnson_rows(&reweighted, &reverse, first, count, distance, next, threads);
+
+		ApTile *tile = &out->tiles[t];
+		tile->data = compress_tile(out, first, count, distance, next, &tile->bytes);
+		tile->fileOffset = -1;
+
+		if (spillPath != NULL && out->memoryBytes + tile->bytes > budget) {
+			if (out->spill == NULL) {
+				out->spillPath = malloc(strlen(spillPath) + 1);
+				strcpy(out->spillPath, spillPath);
+				out->spill = fopen(spillPath, "wb+");
+			}
+			ok = out->spill != NULL && fwrite(tile->data, 1, tile->bytes, out->spill) == tile->bytes;
+			tile->fileOffset = (long long)out->fileBytes;
+			out->fileBytes += tile->bytes;
+			free(tile->data);
+			tile->data = NULL;
+		}
+		else {
+			out->memoryBytes += tile->bytes;
+		}
+	}
+	if (ok && out->spill != NULL) {
+		ok = map_spill(out);
+	}
+
+	free(distance);
+	free(next);
+	destroy_csr_graph(&reverse);
+	destroy_johnson_graph(&reweighted);
+
+	if (!ok) {
+		destroy_ap_store(out);
+	}
+	return ok;
+}
+
+/* Destroys store, freeing all memory and removing its spill file
+******************************************************************/
+void destroy_ap_store(AllPairsStore *self) {
+
+	for (int t = 0; t < self->tileCount; t++) {
+		free(self->tiles[t].data);
+	}
+	free(self->tiles);
+	if (self->spill != NULL) {
+		fclose(self->spill);
+	}
+	if (self->map != NULL) {
+#ifndef _WIN32
+		if (self->mapped) {
+			munmap(self->map, self->fileBytes);
+		}
+		else {
+			free(self->map);
+		}
+#else
+		free(self->map);
+#endif
+	}
+	if (self->spillPath != NULL) {
+		remove(self->spillPath);
+		free(self->spillPath);
+	}
+	memset(self, 0, sizeof *self);
+}
+
+/* Helper function returning the start of source's row, wherever its tile is
+**************************************************************************/
+static const unsigned char *ap_row(AllPairsStore *self, int source) {
+	ApTile *tile = &self->tiles[source / AP_TILE_ROWS];
+	const unsigned char *base = tile->fileOffset == -1 ? tile->data : self->map + tile->fileOffset;
+	uint32_t offset;
+	memcpy(&offset, base + (source % AP_TILE_ROWS) * sizeof(uint32_t), sizeof offset);
+	return base + offset;
+}
+
+/* Shortest distance from source to target (INT_MAX/2 if there is no path; for
+	source = target, the shortest cycle through source)
+*********************************************************************************************/
+int ap_store_distance(AllPairsStore *self, int source, int target) {
+
+	const unsigned char *row = ap_row(self, source);
+	const unsigned char *check = row + code_bytes(self);
+	const unsigned char *stream = check + block_count(self) * sizeof(uint32_t);
+
+	uint32_t offset;
+	memcpy(&offset, check + (target / AP_BLOCK) * sizeof(uint32_t), sizeof offset);
+	const unsigned char *p = stream + offset;
+
+	int value = 0;
+	for (int j = target - target % AP_BLOCK; j <= target; j++) {
+		uint32_t z = 0;
+		int shift = 0;
+		do {
+			z |= (uint32_t)(*p & 0x7f) << shift;
+			shift += 7;
+		} while (*p++ & 0x80);
+		value += (z & 1) ? -(int)(z >> 1) - 1 : (int)(z >> 1);
+	}
+	return value;
+}
+
+/* Vertex after source on the shortest path to target, or -1 if there is no path
+*********************************************************************************/
+int ap_store_next(AllPairsStore *self, int source, int target) {
+
+	if (ap_store_distance(self, source, target) == NO_PATH) {
+		return -1;
+	}
+	const unsigned char *code = ap_row(self, source);
+	size_t bit = (size_t)target * self->codeBits;
+	uint32_t window = code[bit / 8] | code[bit / 8 + 1] << 8 | code[bit / 8 + 2] << 16 | (uint32_t)code[bit / 8 + 3] << 24;
+	uint32_t k = (window >> (bit % 8)) & ((1u << self->codeBits) - 1);
+	return self->graph->to_vertex[self->graph->offsets[source] + k];
+}
+
+/* Writes path from source to target into 'path', following next vertices
+	Returns number of vertices written, or 0 if there is no path or capacity is too small
+*********************************************************************************************/
+int ap_store_path(AllPairsStore *self, int source, int target, int* path, int capacity) {
+
+	if (capacity < 1) {
+		return 0;
+	}
+	int length = 1;
+	path[0] = source;
+	for (int v = source; v != target; ) {
+		v = ap_store_next(self, v, target);
+		if (v == -1 || length == capacity || length > self->V) {
+			return 0;
+		}
+		path[length++] = v;
+	}
+	return length;
+}
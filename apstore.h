@@ -0,0 +1,52 @@
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include "graph.h"
+
+// Rows of the all-pairs tables compressed together
+#define AP_TILE_ROWS 64
+
+// Distances in a row are delta-encoded in blocks of this many entries
+#define AP_BLOCK 64
+
+/* A compressed tile of AP_TILE_ROWS rows, in memory or in the spill file
+**************************************************************************/
+typedef struct apTile {
+	unsigned char *data;		// Tile bytes, if held in memory
+	size_t bytes;
+	long long fileOffset;		// Offset in spill file, or -1 if in memory
+} ApTile;
+
+/* Compressed all-pairs shortest path tables (distance and next vertex for every pair),
+	with the same conventions as floyd_warshall(): no path = INT_MAX/2 and -1.
+
+	Each row of 'next' is stored as the position of the next vertex in the source's
+	edge list, in codeBits bits (2 bits on a DEM grid, whose vertices have at most 4
+	edges). Each row of distances is stored as variable-length differences between
+	neighbouring entries, restarting every AP_BLOCK entries so a lookup decodes at most
+	one block. Tiles go to memory until the budget is used, then to a spill file, which
+	is mapped read-only once the store is built.
+**************************************************************************/
+typedef struct allPairsStore {
+	CsrGraph *graph;			// Not owned; decodes next-vertex codes
+	int V;
+	int codeBits;
+	int tileCount;
+	ApTile *tiles;
+	size_t budget;				// Bytes of tiles to keep in memory
+	size_t memoryBytes;
+	size_t fileBytes;
+	char *spillPath;			// NULL if nothing was spilled
+	FILE *spill;
+	unsigned char *map;			// Spill file contents once built
+	int mapped;					// 1 if map is an mmap, 0 if read into memory
+} AllPairsStore;
+
+// Functions for building/destroying stores
+int ap_store_build(CsrGraph *graph, size_t budget, const char *spillPath, int threads, AllPairsStore *out);
+void destroy_ap_store(AllPairsStore *self);
+
+// Lookups read the compressed tables directly
+int ap_store_distance(AllPairsStore *self, int source, int target);
+int ap_store_next(AllPairsStore *self, int source, int target);
+int ap_store_path(AllPairsStore *self, int source, int target, int* path, int capacity);
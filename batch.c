@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "batch.h"
+#include "stats.h"
+
+/* Initialises a workspace for graphs with vertexCount vertices
+*********************************************/
+Workspace new_workspace(int vertexCount) {
+
+	Workspace ws;
+
+	ws.V = vertexCount;
+	ws.generation = 0;
+	ws.reached = calloc(vertexCount, sizeof(unsigned));	// Generation 0 is never current
+	ws.settled = calloc(vertexCount, sizeof(unsigned));
+	ws.distance = malloc(vertexCount * sizeof(int));
+	ws.previous = malloc(vertexCount * sizeof(int));
+	ws.queue = new_heap(vertexCount, 4);
+
+	return ws;
+}
+
+/* Destroys workspace, freeing all memory
+******************************************/
+void destroy_workspace(Workspace *self) {
+	free(self->reached);
+	free(self->settled);
+	free(self->distance);
+	free(self->previous);
+	destroy_heap(&self->queue);
+}
+
+/* Initialises one workspace for each of 'threads' workers (<= 0 uses every available core)
+*********************************************/
+QueryPool new_query_pool(int vertexCount, int threads) {
+
+	QueryPool pool;
+
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+	pool.threads = threads;
+	pool.workspaces = malloc(threads * sizeof(Workspace));
+	for (int t = 0; t < threads; t++) {
+		pool.workspaces[t] = new_workspace(vertexCount);
+	}
+
+	return pool;
+}
+
+/* Destroys pool and all its workspaces
+******************************************/
+void destroy_query_pool(QueryPool *self) {
+	for (int t = 0; t < self->threads; t++) {
+		destroy_workspace(&self->workspaces[t]);
+	}
+	free(self->workspaces);
+	self->threads = 0;
+}
+
+/* Starts a new query on a workspace: every stamp becomes stale at once
+	Stamps are only cleared when the generation counter wraps around
+*********************************************/
+void workspace_begin(Workspace *self) {
+
+	heap_clear(&self->queue);				// O(entries left by an early exit)
+	self->generation++;
+	if (self->generation == 0) {
+		memset(self->reached, 0, self->V * sizeof(unsigned));
+		memset(self->settled, 0, self->V * sizeof(unsigned));
+		self->generation = 1;
+	}
+}
+
+/* Distance to vertex found by the last query on this workspace (INT_MAX if not reached)
+*****************************************************************************************/
+int workspace_distance(Workspace *self, int vertex) {
+	return self->reached[vertex] == self->generation ? self->distance[vertex] : INT_MAX;
+}
+
+/* Previous vertex on path to vertex from the last query (-1 if none)
+*****************************************************************************************/
+int workspace_previous(Workspace *self, int vertex) {
+	return self->reached[vertex] == self->generation ? self->previous[vertex] : -1;
+}
+
+/* Dijkstra's Shortest Path using a workspace
+	Takes graph, workspace, source, and target (-1 settles every reachable vertex)
+	Returns distance to target (INT_MAX if unreachable; 0 if target = -1)
+	Results stay readable through workspace_distance()/_previous()/_path() until the
+	workspace's next query
+*********************************************************************************************/
+int workspace_dijkstra(CsrGraph *graph, Workspace *self, int source, int target) {
+
+	workspace_begin(self);
+	unsigned gen = self->generation;
+
+	self->reached[source] = gen;
+	self->distance[source] = 0;
+	self->previous[source] = -1;
+	heap_push(&self->queue, source, 0);
+
+	while (!heap_is_empty(&self->queue)) {
+		int nearNode = heap_pop(&self->queue);
+		self->settled[nearNode] = gen;
+		if (nearNode == target) {
+			break;
+		}
+
+		for (int e = graph->offsets[nearNode]; e < graph->offsets[nearNode + 1]; e++) {
+			int to = graph->to_vertex[e];
+			if (self->settled[to] != gen) {
+				int alt = graph->weight[e] + self->distance[nearNode];
+				if (self->reached[to] != gen || alt < self->distance[to]) {
+					self->reached[to] = gen;
+					self->distance[to] = alt;
+					self->previous[to] = nearNode;
+					heap_push(&self->queue, to, alt);
+				}
+			}
+		}
+	}
+
+	return target == -1 ? 0 : workspace_distance(self, target);
+}
+
+/* Writes path from the last query's source to target into 'path'
+	Returns number of vertices written, or 0 if target was not reached or
+	capacity is too small
+*********************************************************************************************/
+int workspace_path(Workspace *self, int target, int *path, int capacity) {
+
+	if (workspace_distance(self, target) == INT_MAX) {
+		return 0;
+	}
+
+	int length = 0;
+	for (int v = target; v != -1; v = workspace_previous(self, v)) {
+		length++;
+	}
+	if (path == NULL || length > capacity) {
+		return 0;
+	}
+
+	int i = length;
+	for (int v = target; v != -1; v = workspace_previous(self, v)) {
+		path[--i] = v;						// Filled back to front, so path starts at source
+	}
+	return length;
+}
+
+/* Answers a batch of route queries against one read-only graph
+	Takes graph, pool (built for graph->V vertices), and array of queries
+	Queries are shared across the pool's threads; each thread reuses its own workspace,
+	so no memory is allocated per query. Results are written into each query.
+*********************************************************************************************/
+void dijkstra_batch(CsrGraph *graph, QueryPool *pool, RouteQuery *queries, int count) {
+
+	STATS_PARENT(parent);
+	#pragma omp parallel num_threads(pool->threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+		#pragma omp for schedule(dynamic)
+		for (int i = 0; i < count; i++) {
+#ifdef _OPENMP
+			Workspace *ws = &pool->workspaces[omp_get_thread_num()];
+#else
+			Workspace *ws = &pool->workspaces[0];
+#endif
+			RouteQuery *q = &queries[i];
+
+			q->cost = workspace_dijkstra(graph, ws, q->source, q->target);
+			q->pathLength = 0;
+
+			if (q->target != -1) {
+				if (q->path != NULL) {
+					q->pathLength = workspace_path(ws, q->target, q->path, q->pathCapacity);
+				}
+			}
+			else {
+				for (int v = 0; v < graph->V; v++) {
+					if (q->distance != NULL) {
+						q->distance[v] = workspace_distance(ws, v);
+					}
+					if (q->previous != NULL) {
+						q->previous[v] = workspace_previous(ws, v);
+					}
+				}
+			}
+		}
+		STATS_WORKER_END(parent);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "graph.h"
+#include "pqueue.h"
+
+/* One route request in a batch, with caller-provided output buffers
+**************************************************************************/
+typedef struct routeQuery {
+	// Input
+	int source;
+	int target;			// Vertex to route to, or -1 for every vertex
+	// Output buffers, supplied by the caller (any may be NULL)
+	int *path;			// Receives vertices from source to target
+	int pathCapacity;	// Entries available in path
+	int *distance;		// Receives all |V| distances (target = -1 only)
+	int *previous;		// Receives all |V| previous vertices (target = -1 only)
+	// Results
+	int cost;			// Distance to target (INT_MAX if unreachable; 0 if target = -1)
+	int pathLength;		// Vertices written to path (0 if unreachable or path too short)
+} RouteQuery;
+
+/* Search state reused from query to query.
+	An entry of distance/previous is only valid if its stamp equals the current
+	generation, so starting a query costs O(1) rather than clearing |V| entries.
+**************************************************************************/
+typedef struct workspace {
+	int V;
+	unsigned generation;
+	unsigned *reached;		// reached[v] == generation => distance[v], previous[v] valid
+	unsigned *settled;		// settled[v] == generation => distance[v] is final
+	int *distance;
+	int *previous;
+	IndexedHeap queue;
+} Workspace;
+
+// One workspace per worker thread
+typedef struct queryPool {
+	int threads;
+	Workspace *workspaces;
+} QueryPool;
+
+// Functions for building/destroying workspaces
+Workspace new_workspace(int vertexCount);
+void destroy_workspace(Workspace *self);
+QueryPool new_query_pool(int vertexCount, int threads);
+void destroy_query_pool(QueryPool *self);
+
+// Single queries on a workspace
+void workspace_begin(Workspace *self);
+int workspace_dijkstra(CsrGraph *graph, Workspace *self, int source, int target);
+int workspace_distance(Workspace *self, int vertex);
+int workspace_previous(Workspace *self, int vertex);
+int workspace_path(Workspace *self, int target, int *path, int capacity);
+
+// Batches of queries, spread across the pool's threads
+void dijkstra_batch(CsrGraph *graph, QueryPool *pool, RouteQuery *queries, int count);
@@ -0,0 +1,773 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "graph.h"
+#include "grid.h"
+#include "johnson.h"
+#include "delta.h"
+#include "dem.h"
+#include "ch.h"
+#include "hpa.h"
+#include "treecache.h"
+#include "apstore.h"
+#include "alt.h"
+#include "sweep.h"
+#include "isochrone.h"
+#include "matrix.h"
+
+/* Benchmark driver
+	Sweeps DEM sizes and roughness values with a fixed seed, and times each stage
+	(DEM generation, graph building, every solver, path tracing) separately.
+	Results are written to stdout as CSV (default) or JSON, one row per stage.
+
+	Usage: bench [--sizes 33,65,...] [--roughness 32,132,...] [--seed N] [--repeats N]
+				 [--threads N] [--format csv|json] [--max-fw-size N]
+				 [--max-linear-size N] [--max-list-size N] [--max-ch-size N]
+				 [--hpa-tile N] [--max-ap-size N] [--landmarks N]
+************************************************************************************/
+
+#define MAX_VALUES 32
+
+typedef struct benchConfig {
+	int sizes[MAX_VALUES];
+	int sizeCount;
+	int roughness[MAX_VALUES];
+	int roughnessCount;
+	unsigned seed;
+	int repeats;
+	int threads;
+	int json;
+	int maxFwSize;			// Largest DEM for |V|x|V| all-pairs solvers
+	int maxLinearSize;		// Largest DEM for the O(V^2) linear scan Dijkstra
+	int maxListSize;		// Largest DEM for the adjacency list graph
+	int maxChSize;			// Largest DEM to build a contraction hierarchy for
+	int hpaTile;			// Tile size for the hierarchical planner
+	int maxApSize;			// Largest DEM to build a compressed all-pairs store for
+	int landmarks;			// Landmark count for ALT
+} BenchConfig;
+
+/* State shared by the stages for one (size, roughness) DEM
+************************************************************/
+typedef struct bench {
+	BenchConfig *config;
+	int size;
+	int roughness;
+	int vertexCount;
+	int** dem;
+	CsrGraph graphA;		// cost_funcA weights (non-negative)
+	CsrGraph graphB;		// cost_funcB weights (may be negative)
+	CsrGraph reverseA;
+	ContractionHierarchy ch;	// Built by stage_ch_build (V = 0 until then)
+	AllPairsStore store;		// Built by stage_ap_store_build (V = 0 until then)
+	Landmarks landmarks;		// Built by stage_alt_build (V = 0 until then)
+	JohnsonGraph johnson;		// Built by stage_johnson_prepare (graph.V = 0 until then)
+	int *distance;
+	int *previous;
+	int *path;
+	double gap;				// Optimality gap (%) reported with the next stage, or < 0 for none
+} Bench;
+
+// A stage runs once, and returns the seconds spent in the part being measured
+typedef double (*Stage)(Bench *b);
+
+static int rows = 0;		// Rows written so far (for JSON separators)
+
+
+/* Timing and memory helpers
+******************************/
+static double now(void) {
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Resets the peak resident set size where the OS allows it (Linux), so each stage
+	reports its own peak rather than the largest seen so far in the process
+***********************************************************************************/
+static void reset_peak_rss(void) {
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f != NULL) {
+		fputs("5", f);
+		fclose(f);
+	}
+}
+
+/* Returns peak resident set size in kB since the last reset_peak_rss() (or process start)
+******************************************************************************************/
+static long peak_rss_kb(void) {
+	long kb = -1;
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f != NULL) {
+		char line[256];
+		while (fgets(line, sizeof line, f)) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				kb = strtol(line + 6, NULL, 10);
+				break;
+			}
+		}
+		fclose(f);
+	}
+#ifndef _WIN32
+	if (kb < 0) {
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		kb = usage.ru_maxrss;
+	}
+#endif
+	return kb;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/* Returns the p-th percentile (nearest rank) of n sorted values
+*****************************************************************/
+static double percentile(double *sorted, int n, double p) {
+	int rank = (int)(p / 100.0 * n + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	}
+	return sorted[rank > n ? n - 1 : rank - 1];
+}
+
+
+/* Stages
+	Each one measures a single operation; setup and cleanup are not timed
+****************************************************************************/
+static double stage_make_dem(Bench *b) {
+	double start = now();
+	int** dem = make_dem_seeded(b->size, b->roughness, b->config->seed);
+	double elapsed = now() - start;
+	free_dem(dem, b->size);
+	return elapsed;
+}
+
+static double stage_make_dem_flat(Bench *b) {
+	double start = now();
+	int* heights = make_dem_flat(b->size, b->roughness, b->config->seed, b->config->threads);
+	double elapsed = now() - start;
+	free(heights);
+	return elapsed;
+}
+
+static double stage_build_graph(Bench *b) {
+	double start = now();
+	Graph graph = new_graph(b->vertexCount);
+	build_graph(graph, b->dem, b->size, 0);
+	double elapsed = now() - start;
+	destroy_graph(&graph);
+	return elapsed;
+}
+
+static double stage_build_csr_graph(Bench *b) {
+	double start = now();
+	CsrGraph graph = build_csr_graph(b->dem, b->size, 0);
+	double elapsed = now() - start;
+	destroy_csr_graph(&graph);
+	return elapsed;
+}
+
+static double stage_build_csr_graph_parallel(Bench *b) {
+	double start = now();
+	CsrGraph graph = build_csr_graph_parallel(b->dem, b->size, 0, b->config->threads);
+	double elapsed = now() - start;
+	destroy_csr_graph(&graph);
+	return elapsed;
+}
+
+static double stage_dijkstra(Bench *b) {
+	Graph graph = new_graph(b->vertexCount);
+	build_graph(graph, b->dem, b->size, 0);
+	double start = now();
+	dijkstra(&graph, 0, b->distance, b->previous);
+	double elapsed = now() - start;
+	destroy_graph(&graph);
+	return elapsed;
+}
+
+static double run_engine(Bench *b, DijkstraEngine engine) {
+	double start = now();
+	dijkstra_csr_with(&b->graphA, 0, b->distance, b->previous, engine);
+	return now() - start;
+}
+
+static double stage_dijkstra_linear(Bench *b) {
+	return run_engine(b, DIJKSTRA_LINEAR);
+}
+
+static double stage_dijkstra_binary_heap(Bench *b) {
+	return run_engine(b, DIJKSTRA_BINARY_HEAP);
+}
+
+static double stage_dijkstra_quad_heap(Bench *b) {
+	return run_engine(b, DIJKSTRA_QUAD_HEAP);
+}
+
+static double stage_dijkstra_dial(Bench *b) {
+	return run_engine(b, DIJKSTRA_DIAL);
+}
+
+static double stage_dijkstra_radix_heap(Bench *b) {
+	return run_engine(b, DIJKSTRA_RADIX_HEAP);
+}
+
+static double stage_dijkstra_target(Bench *b) {
+	double start = now();
+	dijkstra_csr_target(&b->graphA, 0, b->vertexCount - 1, b->distance, b->previous);
+	return now() - start;
+}
+
+static double stage_astar(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	GridHeuristic h = grid_heuristic(&grid, b->vertexCount - 1);
+	double start = now();
+	astar_csr(&b->graphA, 0, b->vertexCount - 1, grid_manhattan, &h, b->distance, b->previous);
+	double elapsed = now() - start;
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+static double stage_alt_build(Bench *b) {
+	if (b->landmarks.V) {
+		destroy_landmarks(&b->landmarks);
+	}
+	double start = now();
+	b->landmarks = build_landmarks(&b->graphA, b->config->landmarks, LANDMARKS_FARTHEST, b->config->threads);
+	return now() - start;
+}
+
+static double stage_alt_query(Bench *b) {
+	double start = now();
+	alt_query(&b->graphA, &b->landmarks, 0, b->vertexCount - 1, b->distance, b->previous);
+	return now() - start;
+}
+
+static double stage_bidirectional(Bench *b) {
+	double start = now();
+	bidirectional_dijkstra_csr(&b->graphA, &b->reverseA, 0, b->vertexCount - 1, b->previous);
+	return now() - start;
+}
+
+static double stage_delta_stepping(Bench *b) {
+	double start = now();
+	delta_stepping_csr(&b->graphA, 0, b->distance, b->previous, 0, b->config->threads);
+	return now() - start;
+}
+
+static double stage_grid_dijkstra(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	double start = now();
+	grid_dijkstra(&grid, 0, b->distance, b->previous);
+	double elapsed = now() - start;
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+static double stage_grid_sweep(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	double start = now();
+	grid_sweep(&grid, 0, b->distance, b->previous, b->config->threads);
+	double elapsed = now() - start;
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+static double stage_grid_sweep_negative(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcB);
+	double start = now();
+	grid_sweep(&grid, 0, b->distance, b->previous, b->config->threads);
+	double elapsed = now() - start;
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+static double stage_isochrone(Bench *b) {
+	int budget = dijkstra_csr_target(&b->graphA, 0, b->vertexCount - 1, b->distance, b->previous) / 4;
+	int source = 0;
+	Workspace ws = new_workspace(b->vertexCount);
+	double start = now();
+	isochrone(&b->graphA, &ws, &source, 1, budget, b->path, b->vertexCount, NULL);
+	double elapsed = now() - start;
+	destroy_workspace(&ws);
+	return elapsed;
+}
+
+static double stage_ch_build(Bench *b) {
+	if (b->ch.V) {
+		destroy_contraction_hierarchy(&b->ch);
+	}
+	double start = now();
+	b->ch = build_contraction_hierarchy(&b->graphA);
+	return now() - start;
+}
+
+static double stage_ch_query(Bench *b) {
+	Workspace forward = new_workspace(b->vertexCount);
+	Workspace backward = new_workspace(b->vertexCount);
+	int pathLength;
+	double start = now();
+	ch_query(&b->ch, &forward, &backward, 0, b->vertexCount - 1, b->path, b->vertexCount, &pathLength);
+	double elapsed = now() - start;
+	destroy_workspace(&forward);
+	destroy_workspace(&backward);
+	return elapsed;
+}
+
+/* Helper for many-to-many stages; spreads MATRIX_SIZE sources and targets over the DEM
+***************************************************************************************/
+#define MATRIX_SIZE 100
+
+static void matrix_endpoints(Bench *b, int *sources, int *targets) {
+	for (int i = 0; i < MATRIX_SIZE; i++) {
+		sources[i] = (int)((long long)i * b->vertexCount / MATRIX_SIZE);
+		targets[i] = (int)(((long long)i * 2 + 1) * b->vertexCount / (2 * MATRIX_SIZE));
+	}
+}
+
+static double stage_many_to_many(Bench *b) {
+	int sources[MATRIX_SIZE], targets[MATRIX_SIZE];
+	int *table = malloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
+	QueryPool pool = new_query_pool(b->vertexCount, b->config->threads);
+	matrix_endpoints(b, sources, targets);
+	double start = now();
+	many_to_many(&b->graphA, &pool, sources, MATRIX_SIZE, targets, MATRIX_SIZE, table, NULL, 0, NULL);
+	double elapsed = now() - start;
+	destroy_query_pool(&pool);
+	free(table);
+	return elapsed;
+}
+
+static double stage_ch_many_to_many(Bench *b) {
+	int sources[MATRIX_SIZE], targets[MATRIX_SIZE];
+	int *table = malloc(MATRIX_SIZE * MATRIX_SIZE * sizeof(int));
+	QueryPool pool = new_query_pool(b->vertexCount, b->config->threads);
+	matrix_endpoints(b, sources, targets);
+	double start = now();
+	ch_many_to_many(&b->ch, &pool, sources, MATRIX_SIZE, targets, MATRIX_SIZE, table);
+	double elapsed = now() - start;
+	destroy_query_pool(&pool);
+	free(table);
+	return elapsed;
+}
+
+static double stage_hpa_build(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	double start = now();
+	HpaPlanner planner = new_hpa_planner(&grid, b->config->hpaTile, 0, b->config->threads);
+	double elapsed = now() - start;
+	destroy_hpa_planner(&planner);
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+static double stage_hpa_route(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	HpaPlanner planner = new_hpa_planner(&grid, b->config->hpaTile, 0, b->config->threads);
+	int pathLength;
+	double start = now();
+	hpa_route(&planner, 0, b->vertexCount - 1, b->path, b->vertexCount, &pathLength);
+	double elapsed = now() - start;
+	destroy_hpa_planner(&planner);
+	destroy_grid_graph(&grid);
+	return elapsed;
+}
+
+/* Helper for run_dem(); optimality gap (%) of the route stage_hpa_route() plans
+***************************************************************************/
+static double hpa_gap(Bench *b) {
+	GridGraph grid = grid_from_dem(b->dem, b->size, cost_funcA);
+	HpaPlanner planner = new_hpa_planner(&grid, b->config->hpaTile, 0, b->config->threads);
+	double gap = 100.0 * hpa_optimality_gap(&planner, 0, b->vertexCount - 1);
+	destroy_hpa_planner(&planner);
+	destroy_grid_graph(&grid);
+	return gap;
+}
+
+static double stage_tree_cache_hit(Bench *b) {
+	TreeCache cache = new_tree_cache((size_t)b->vertexCount * 2 * sizeof(int) + 4096, 1);
+	tree_cache_dijkstra(&cache, &b->graphA, 0, 0, b->distance, b->previous);
+	double start = now();
+	tree_cache_dijkstra(&cache, &b->graphA, 0, 0, b->distance, b->previous);
+	double elapsed = now() - start;
+	destroy_tree_cache(&cache);
+	return elapsed;
+}
+
+static double stage_johnson_prepare(Bench *b) {
+	if (b->johnson.graph.V) {
+		destroy_johnson_graph(&b->johnson);
+	}
+	double start = now();
+	johnson_prepare(&b->graphB, &b->johnson);
+	return now() - start;
+}
+
+static double stage_johnson_query(Bench *b) {
+	double start = now();
+	johnson_query(&b->johnson, 0, b->vertexCount - 1, b->distance, b->previous);
+	return now() - start;
+}
+
+/* Helper for all-pairs stages; allocates and initialises flat tables as
+	fw_initialise_distance()/fw_initialise_next() do
+***************************************************************************/
+static void all_pairs_tables(Bench *b, int **distance, int **next) {
+	size_t cells = (size_t)b->vertexCount * b->vertexCount;
+	*distance = malloc(cells * sizeof(int));
+	*next = malloc(cells * sizeof(int));
+	for (size_t i = 0; i < cells; i++) {
+		(*distance)[i] = INT_MAX / 2;
+		(*next)[i] = -1;
+	}
+}
+
+static double stage_floyd_warshall(Bench *b) {
+	int *distance;
+	int *next;
+	all_pairs_tables(b, &distance, &next);
+	int** distRows = malloc(b->vertexCount * sizeof *distRows);
+	int** nextRows = malloc(b->vertexCount * sizeof *nextRows);
+	for (int i = 0; i < b->vertexCount; i++) {
+		distRows[i] = distance + (size_t)i * b->vertexCount;
+		nextRows[i] = next + (size_t)i * b->vertexCount;
+	}
+	double start = now();
+	floyd_warshall_csr(&b->graphB, distRows, nextRows);
+	double elapsed = now() - start;
+	free(distRows);
+	free(nextRows);
+	free(distance);
+	free(next);
+	return elapsed;
+}
+
+static double stage_floyd_warshall_blocked(Bench *b) {
+	int *distance;
+	int *next;
+	all_pairs_tables(b, &distance, &next);
+	double start = now();
+	floyd_warshall_blocked(&b->graphB, distance, next, FW_BLOCK_SIZE, b->config->threads);
+	double elapsed = now() - start;
+	free(distance);
+	free(next);
+	return elapsed;
+}
+
+static double stage_johnson_all_pairs(Bench *b) {
+	size_t cells = (size_t)b->vertexCount * b->vertexCount;
+	int *distance = malloc(cells * sizeof(int));
+	int *next = malloc(cells * sizeof(int));
+	double start = now();
+	johnson_all_pairs(&b->graphB, distance, next, b->config->threads);
+	double elapsed = now() - start;
+	free(distance);
+	free(next);
+	return elapsed;
+}
+
+static double stage_ap_store_build(Bench *b) {
+	if (b->store.V) {
+		destroy_ap_store(&b->store);
+	}
+	double start = now();
+	ap_store_build(&b->graphB, (size_t)-1, NULL, b->config->threads, &b->store);
+	return now() - start;
+}
+
+static double stage_ap_store_path(Bench *b) {
+	double start = now();
+	ap_store_path(&b->store, 0, b->vertexCount - 1, b->path, b->vertexCount);
+	return now() - start;
+}
+
+static double stage_trace_path(Bench *b) {
+	dijkstra_csr_target(&b->graphA, 0, b->vertexCount - 1, b->distance, b->previous);
+	double start = now();
+	int length = 0;
+	for (int v = b->vertexCount - 1; v != -1; v = b->previous[v]) {	// As trace_path_dijkstra(), without printing
+		b->path[length++] = v;
+	}
+	return now() - start;
+}
+
+
+/* Runs a stage config->repeats times and writes one result row
+*****************************************************************/
+static void run_stage(Bench *b, const char *name, Stage stage) {
+
+	BenchConfig *config = b->config;
+	double *times = malloc(config->repeats * sizeof(double));
+
+	fprintf(stderr, "size %d roughness %d: %s\n", b->size, b->roughness, name);
+
+	reset_peak_rss();
+	for (int r = 0; r < config->repeats; r++) {
+		times[r] = stage(b);
+	}
+	long rss = peak_rss_kb();
+	qsort(times, config->repeats, sizeof(double), compare_doubles);
+
+	double median = percentile(times, config->repeats, 50);
+	double p90 = percentile(times, config->repeats, 90);
+	double p99 = percentile(times, config->repeats, 99);
+
+	char gap[32] = "";
+	if (b->gap >= 0) {
+		snprintf(gap, sizeof gap, "%.4f", b->gap);
+	}
+
+	if (config->json) {
+		printf("%s\n  {\"size\": %d, \"roughness\": %d, \"seed\": %u, \"stage\": \"%s\", \"repeats\": %d, "
+			"\"median_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, "
+			"\"peak_rss_kb\": %ld, \"gap_pct\": %s}",
+			rows ? "," : "", b->size, b->roughness, config->seed, name, config->repeats,
+			median * 1e3, p90 * 1e3, p99 * 1e3, times[0] * 1e3, times[config->repeats - 1] * 1e3, rss,
+			b->gap >= 0 ? gap : "null");
+	}
+	else {
+		printf("%d,%d,%u,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%ld,%s\n",
+			b->size, b->roughness, config->seed, name, config->repeats,
+			median * 1e3, p90 * 1e3, p99 * 1e3, times[0] * 1e3, times[config->repeats - 1] * 1e3, rss, gap);
+	}
+	fflush(stdout);
+	rows++;
+	free(times);
+}
+
+/* Runs every stage that is feasible at this size
+***************************************************/
+static void run_dem(BenchConfig *config, int size, int roughness) {
+
+	Bench b;
+	b.config = config;
+	b.size = size;
+	b.roughness = roughness;
+	b.vertexCount = size * size;
+	b.dem = make_dem_seeded(size, roughness, config->seed);
+	b.graphA = build_csr_graph(b.dem, size, 0);
+	b.graphB = build_csr_graph(b.dem, size, 1);
+	b.reverseA = csr_transpose(&b.graphA);
+	b.ch.V = 0;
+	b.store.V = 0;
+	b.landmarks.V = 0;
+	b.gap = -1.0;
+	b.johnson.graph.V = 0;
+	b.distance = malloc(b.vertexCount * sizeof(int));
+	b.previous = malloc(b.vertexCount * sizeof(int));
+	b.path = malloc(b.vertexCount * sizeof(int));
+
+	run_stage(&b, "make_dem", stage_make_dem);
+	run_stage(&b, "make_dem_flat", stage_make_dem_flat);
+	run_stage(&b, "build_csr_graph", stage_build_csr_graph);
+	run_stage(&b, "build_csr_graph_parallel", stage_build_csr_graph_parallel);
+	if (size <= config->maxListSize) {
+		run_stage(&b, "build_graph", stage_build_graph);
+		run_stage(&b, "dijkstra", stage_dijkstra);
+	}
+	if (size <= config->maxLinearSize) {
+		run_stage(&b, "dijkstra_linear", stage_dijkstra_linear);
+	}
+	run_stage(&b, "dijkstra_binary_heap", stage_dijkstra_binary_heap);
+	run_stage(&b, "dijkstra_quad_heap", stage_dijkstra_quad_heap);
+	run_stage(&b, "dijkstra_dial", stage_dijkstra_dial);
+	run_stage(&b, "dijkstra_radix_heap", stage_dijkstra_radix_heap);
+	run_stage(&b, "delta_stepping", stage_delta_stepping);
+	run_stage(&b, "grid_dijkstra", stage_grid_dijkstra);
+	run_stage(&b, "grid_sweep", stage_grid_sweep);
+	run_stage(&b, "grid_sweep_negative", stage_grid_sweep_negative);
+	run_stage(&b, "dijkstra_target", stage_dijkstra_target);
+	run_stage(&b, "isochrone", stage_isochrone);
+	run_stage(&b, "astar", stage_astar);
+	run_stage(&b, "alt_build", stage_alt_build);
+	run_stage(&b, "alt_query", stage_alt_query);
+	run_stage(&b, "bidirectional", stage_bidirectional);
+	if (size <= config->maxChSize) {
+		run_stage(&b, "ch_build", stage_ch_build);
+		run_stage(&b, "ch_query", stage_ch_query);
+		run_stage(&b, "ch_many_to_many", stage_ch_many_to_many);
+	}
+	run_stage(&b, "many_to_many", stage_many_to_many);
+	run_stage(&b, "tree_cache_hit", stage_tree_cache_hit);
+	run_stage(&b, "hpa_build", stage_hpa_build);
+	b.gap = hpa_gap(&b);
+	run_stage(&b, "hpa_route", stage_hpa_route);
+	b.gap = -1.0;
+	run_stage(&b, "johnson_prepare", stage_johnson_prepare);
+	if (b.johnson.graph.V) {
+		run_stage(&b, "johnson_query", stage_johnson_query);
+	}
+	if (size <= config->maxFwSize) {
+		run_stage(&b, "floyd_warshall", stage_floyd_warshall);
+		run_stage(&b, "floyd_warshall_blocked", stage_floyd_warshall_blocked);
+		run_stage(&b, "johnson_all_pairs", stage_johnson_all_pairs);
+	}
+	if (size <= config->maxApSize) {
+		run_stage(&b, "ap_store_build", stage_ap_store_build);
+		if (b.store.V) {
+			run_stage(&b, "ap_store_path", stage_ap_store_path);
+		}
+	}
+	run_stage(&b, "trace_path", stage_trace_path);
+
+	free(b.distance);
+	free(b.previous);
+	free(b.path);
+	destroy_csr_graph(&b.graphA);
+	destroy_csr_graph(&b.graphB);
+	destroy_csr_graph(&b.reverseA);
+	if (b.ch.V) {
+		destroy_contraction_hierarchy(&b.ch);
+	}
+	if (b.store.V) {
+		destroy_ap_store(&b.store);
+	}
+	if (b.landmarks.V) {
+		destroy_landmarks(&b.landmarks);
+	}
+	if (b.johnson.graph.V) {
+		destroy_johnson_graph(&b.johnson);
+	}
+	free_dem(b.dem, size);
+}
+
+/* Parses a comma separated list of integers into values
+	Returns number of values read
+*************************************************************/
+static int parse_list(const char *text, int *values) {
+	int count = 0;
+	while (*text && count < MAX_VALUES) {
+		char *end;
+		values[count++] = (int)strtol(text, &end, 10);
+		if (end == text) {
+			return count - 1;
+		}
+		text = *end == ',' ? end + 1 : end;
+	}
+	return count;
+}
+
+static void usage(const char *program) {
+	fprintf(stderr, "Usage: %s [--sizes 33,65,...] [--roughness 32,132,...] [--seed N] [--repeats N]\n"
+		"          [--threads N] [--format csv|json] [--max-fw-size N]\n"
+		"          [--max-linear-size N] [--max-list-size N] [--max-ch-size N]\n"
+		"          [--hpa-tile N] [--max-ap-size N] [--landmarks N]\n", program);
+}
+
+
+/* Main function
+******************/
+int main(int argc, char *argv[]) {
+
+	BenchConfig config = {
+		{ 33, 65, 129, 257, 513, 1025, 2049, 4097 }, 8,
+		{ 32, 132 }, 2,
+		12345u,			// seed
+		5,				// repeats
+		0,				// threads (all cores)
+		0,				// CSV
+		33,				// floyd_warshall is O(V^3) with |V|x|V| tables
+		129,			// linear scan Dijkstra is O(V^2)
+		2049,			// adjacency lists need one allocation per edge
+		129,			// contraction is slow to preprocess on large DEMs
+		16,				// hpa tile size
+		65,				// all-pairs store computes |V| Dijkstra searches
+		8				// ALT landmarks
+	};
+
+	for (int i = 1; i < argc; i++) {
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value == NULL) {
+			usage(argv[0]);
+			return 1;
+		}
+		if (strcmp(argv[i], "--sizes") == 0) {
+			config.sizeCount = parse_list(value, config.sizes);
+		}
+		else if (strcmp(argv[i], "--roughness") == 0) {
+			config.roughnessCount = parse_list(value, config.roughness);
+		}
+		else if (strcmp(argv[i], "--seed") == 0) {
+			config.seed = (unsigned)strtoul(value, NULL, 10);
+		}
+		else if (strcmp(argv[i], "--repeats") == 0) {
+			config.repeats = atoi(value);
+		}
+		else if (strcmp(argv[i], "--threads") == 0) {
+			config.threads = atoi(value);
+		}
+		else if (strcmp(argv[i], "--format") == 0) {
+			config.json = strcmp(value, "json") == 0;
+		}
+		else if (strcmp(argv[i], "--max-fw-size") == 0) {
+			config.maxFwSize = atoi(value);
+		}
+		else if (strcmp(argv[i], "--max-linear-size") == 0) {
+			config.maxLinearSize = atoi(value);
+		}
+		else if (strcmp(argv[i], "--max-list-size") == 0) {
+			config.maxListSize = atoi(value);
+		}
+		else if (strcmp(argv[i], "--max-ch-size") == 0) {
+			config.maxChSize = atoi(value);
+		}
+		else if (strcmp(argv[i], "--hpa-tile") == 0) {
+			config.hpaTile = atoi(value);
+		}
+		else if (strcmp(argv[i], "--max-ap-size") == 0) {
+			config.maxApSize = atoi(value);
+		}
+		else if (strcmp(argv[i], "--landmarks") == 0) {
+			config.landmarks = atoi(value);
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+	if (config.repeats < 1) {
+		config.repeats = 1;
+	}
+
+	if (config.json) {
+		printf("[");
+	}
+	else {
+		printf("size,roughness,seed,stage,repeats,median_ms,p90_ms,p99_ms,min_ms,max_ms,peak_rss_kb,gap_pct\n");
+	}
+
+	fprintf(stderr, "grid_sweep kernel: %s\n", grid_sweep_kernel());
+
+	for (int s = 0; s < config.sizeCount; s++) {
+		int size = config.sizes[s];
+		if (size < 3 || ((size - 1) & (size - 2)) != 0) {
+			fprintf(stderr, "Skipping size %d: DEM size must be 2^n + 1\n", size);
+			continue;
+		}
+		for (int r = 0; r < config.roughnessCount; r++) {
+			if (config.roughness[r] < 1) {
+				fprintf(stderr, "Skipping roughness %d: must be at least 1\n", config.roughness[r]);
+				continue;
+			}
+			run_dem(&config, size, config.roughness[r]);
+		}
+	}
+
+	if (config.json) {
+		printf("\n]\n");
+	}
+	return 0;
+}
@@ -0,0 +1,622 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "ch.h"
+
+#define CH_MAGIC "DEMC"
+#define CH_VERSION 1
+#define WITNESS_SETTLE_LIMIT 500	// Vertices a witness search may settle before giving up
+#define ESTIMATE_SETTLE_LIMIT 50	// The same, when only counting shortcuts for the order
+
+/* Arcs of the graph being contracted; shortcuts are added as vertices are removed
+**************************************************************************/
+typedef struct chArc {
+	int to;
+	int weight;
+	int middle;			// Vertex bypassed by shortcut, or -1
+} ChArc;
+
+typedef struct arcList {
+	int count;
+	int capacity;
+	ChArc *arcs;
+} ArcList;
+
+typedef struct contraction {
+	int V;
+	ArcList *out;				// out[u] = arcs u->w
+	ArcList *in;				// in[w] = arcs u->w, with 'to' = u
+	char *contracted;
+	int *contractedNeighbours;
+	unsigned *targetMark;		// targetMark[w] = stamp if w is sought by the current witness search
+	unsigned stamp;
+	Workspace witness;
+} Contraction;
+
+/* Helper function which finds arc to vertex in list
+	Returns index of arc, or -1
+**************************************************************************/
+static int arc_find(ArcList *list, int to) {
+	for (int i = 0; i < list->count; i++) {
+		if (list->arcs[i].to == to) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void arc_append(ArcList *list, int to, int weight, int middle) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 4;
+		list->arcs = realloc(list->arcs, list->capacity * sizeof(ChArc));
+	}
+	list->arcs[list->count].to = to;
+	list->arcs[list->count].weight = weight;
+	list->arcs[list->count].middle = middle;
+	list->count++;
+}
+
+/* Adds arc u->w, or lowers the weight of an existing one; only the shortest arc
+	between two vertices is kept, so (u, w) identifies an arc when unpacking paths
+**************************************************************************/
+static void add_arc(Contraction *c, int u, int w, int weight, int middle) {
+
+	if (u == w) {
+		return;
+	}
+	int i = arc_find(&c->out[u], w);
+	if (i == -1) {
+		arc_append(&c->out[u], w, weight, middle);
+		arc_append(&c->in[w], u, weight, middle);
+	}
+	else if (weight < c->out[u].arcs[i].weight) {
+		int j = arc_find(&c->in[w], u);
+		c->out[u].arcs[i].weight = c->in[w].arcs[j].weight = weight;
+		c->out[u].arcs[i].middle = c->in[w].arcs[j].middle = middle;
+	}
+}
+
+/* Helper function which searches from source among uncontracted vertices other than
+	'avoid', up to distance limit or until all 'targets' marked vertices are settled.
+	Distances found are read with workspace_distance()
+**************************************************************************/
+static void witness_search(Contraction *c, int source, int avoid, int limit, int targets, int settleLimit) {
+
+	Workspace *ws = &c->witness;
+	workspace_begin(ws);
+	unsigned gen = ws->generation;
+
+	ws->reached[source] = gen;
+	ws->distance[source] = 0;
+	heap_push(&ws->queue, source, 0);
+
+	for (int settledCount = 0; !heap_is_empty(&ws->queue); settledCount++) {
+		if (heap_min_key(&ws->queue) > limit || settledCount >= settleLimit) {
+			break;
+		}
+		int v = heap_pop(&ws->queue);
+		ws->settled[v] = gen;
+		if (c->targetMark[v] == c->stamp && --targets == 0) {
+			break;
+		}
+
+		for (int i = 0; i < c->out[v].count; i++) {
+			ChArc *arc = &c->out[v].arcs[i];
+			int to = arc->to;
+			if (c->contracted[to] || to == avoid || ws->settled[to] == gen) {
+				continue;
+			}
+			int alt = ws->distance[v] + arc->weight;
+			if (ws->reached[to] != gen || alt < ws->distance[to]) {
+				ws->reached[to] = gen;
+				ws->distance[to] = alt;
+				heap_push(&ws->queue, to, alt);
+			}
+		}
+	}
+}
+
+/* Finds the shortcuts needed to contract v: one for each u->v->w with no path from u
+	to w, avoiding v, that is as short. Adds them if 'apply' is set.
+	Returns number of shortcuts
+**************************************************************************/
+static int contract_vertex(Contraction *c, int v, int apply) {
+
+	int shortcuts = 0;
+
+	for (int i = 0; i < c->in[v].count; i++) {
+		ChArc inArc = c->in[v].arcs[i];
+		int u = inArc.to;
+		if (c->contracted[u]) {
+			continue;
+		}
+
+		int limit = -1;							// Longest u->v->w to check
+		int targets = 0;
+		c->stamp++;
+		for (int j = 0; j < c->out[v].count; j++) {
+			ChArc *outArc = &c->out[v].arcs[j];
+			if (!c->contracted[outArc->to] && outArc->to != u) {
+				c->targetMark[outArc->to] = c->stamp;
+				targets++;
+				if (inArc.weight + outArc->weight > limit) {
+					limit = inArc.weight + outArc->weight;
+				}
+			}
+		}
+		if (targets == 0) {
+			continue;
+		}
+
+		witness_search(c, u, v, limit, targets, apply ? WITNESS_SETTLE_LIMIT : ESTIMATE_SETTLE_LIMIT);
+
+		for (int j = 0; j < c->out[v].count; j++) {
+			ChArc outArc = c->out[v].arcs[j];
+			int w = outArc.to;
+			if (c->contracted[w] || w == u) {
+				continue;
+			}
+			int via = inArc.weight + outArc.weight;
+			if (workspace_distance(&c->witness, w) > via) {		// No witness path
+				shortcuts++;
+				if (apply) {
+					add_arc(c, u, w, via, v);
+				}
+			}
+		}
+	}
+	return shortcuts;
+}
+
+/* Priority of v in the contraction order (smaller = contract sooner):
+	edge difference (shortcuts added - arcs removed), plus number of neighbours
+	already contracted, which spreads contraction evenly over the graph
+**************************************************************************/
+static int contraction_priority(Contraction *c, int v) {
+
+	int removed = 0;
+	for (int i = 0; i < c->in[v].count; i++) {
+		removed += !c->contracted[c->in[v].arcs[i].to];
+	}
+	for (int i = 0; i < c->out[v].count; i++) {
+		removed += !c->contracted[c->out[v].arcs[i].to];
+	}
+	return contract_vertex(c, v, 0) - removed + c->contractedNeighbours[v];
+}
+
+/* Helper function which builds 'up' (upward = 1) or 'down' arcs of the hierarchy
+	from the final arc lists
+**************************************************************************/
+static void collect_arcs(Contraction *c, int *rank, int upward, CsrGraph *graph, int **middle) {
+
+	int vertexCount = c->V;
+	int count = 0;
+
+	for (int u = 0; u < vertexCount; u++) {
+		for (int i = 0; i < c->out[u].count; i++) {
+			count += (rank[u] < rank[c->out[u].arcs[i].to]) == upward;
+		}
+	}
+
+	*graph = new_csr_graph(vertexCount, count);
+	*middle = malloc(count * sizeof(int));
+
+	for (int u = 0; u < vertexCount; u++) {				// Count arcs stored at each vertex
+		for (int i = 0; i < c->out[u].count; i++) {
+			int w = c->out[u].arcs[i].to;
+			if ((rank[u] < rank[w]) == upward) {
+				graph->offsets[(upward ? u : w) + 1]++;
+			}
+		}
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		graph->offsets[v + 1] += graph->offsets[v];
+	}
+
+	int *fill = malloc(vertexCount * sizeof(int));
+	memcpy(fill, graph->offsets, vertexCount * sizeof(int));
+	for (int u = 0; u < vertexCount; u++) {
+		for (int i = 0; i < c->out[u].count; i++) {
+			ChArc *arc = &c->out[u].arcs[i];
+			if ((rank[u] < rank[arc->to]) == upward) {
+				int at = upward ? u : arc->to;
+				int slot = fill[at]++;
+				graph->to_vertex[slot] = upward ? arc->to : u;
+				graph->weight[slot] = arc->weight;
+				(*middle)[slot] = arc->middle;
+			}
+		}
+	}
+	free(fill);
+}
+
+/* Builds a contraction hierarchy
+	Takes a graph with non-negative weights (parallel edges keep the lightest)
+	Vertices are contracted in order of contraction_priority(). Queue keys are not
+	updated when a neighbour is contracted (only its contractedNeighbours count is);
+	instead a vertex's priority is recomputed when it is taken from the queue, and it
+	is queued again if it is no longer the smallest.
+*********************************************************************************************/
+ContractionHierarchy build_contraction_hierarchy(CsrGraph *graph) {
+
+	int vertexCount = graph->V;
+	Contraction c;
+
+	c.V = vertexCount;
+	c.out = calloc(vertexCount, sizeof(ArcList));
+	c.in = calloc(vertexCount, sizeof(ArcList));
+	c.contracted = calloc(vertexCount, 1);
+	c.contractedNeighbours = calloc(vertexCount, sizeof(int));
+	c.targetMark = calloc(vertexCount, sizeof(unsigned));
+	c.stamp = 0;
+	c.witness = new_workspace(vertexCount);
+
+	for (int u = 0; u < vertexCount; u++) {
+		for (int e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+			add_arc(&c, u, graph->to_vertex[e], graph->weight[e], -1);
+		}
+	}
+
+	ContractionHierarchy ch;
+	ch.V = vertexCount;
+	ch.rank = malloc(vertexCount * sizeof(int));
+
+	IndexedHeap order = new_heap(vertexCount, 4);
+	for (int v = 0; v < vertexCount; v++) {
+		heap_push(&order, v, contraction_priority(&c, v));
+	}
+
+	int nextRank = 0;
+	while (!heap_is_empty(&order)) {
+		int v = heap_pop(&order);
+		int priority = contraction_priority(&c, v);
+		if (!heap_is_empty(&order) && priority > heap_min_key(&order)) {
+			heap_push(&order, v, priority);			// Priority was stale; try again later
+			continue;
+		}
+
+		contract_vertex(&c, v, 1);
+		c.contracted[v] = 1;
+		ch.rank[v] = nextRank++;
+
+		for (int side = 0; side < 2; side++) {		// Refresh neighbours
+			ArcList *list = side ? &c.in[v] : &c.out[v];
+			for (int i = 0; i < list->count; i++) {
+				int x = list->arcs[i].to;
+				if (!c.contracted[x]) {
+					c.contractedNeighbours[x]++;
+				}
+			}
+		}
+	}
+
+	collect_arcs(&c, ch.rank, 1, &ch.up, &ch.upMiddle);
+	collect_arcs(&c, ch.rank, 0, &ch.down, &ch.downMiddle);
+
+	for (int v = 0; v < vertexCount; v++) {
+		free(c.out[v].arcs);
+		free(c.in[v].arcs);
+	}
+	free(c.out);
+	free(c.in);
+	free(c.contracted);
+	free(c.contractedNeighbours);
+	free(c.targetMark);
+	destroy_workspace(&c.witness);
+	destroy_heap(&order);
+
+	return ch;
+}
+
+/* Destroys hierarchy, freeing all memory
+******************************************/
+void destroy_contraction_hierarchy(ContractionHierarchy *self) {
+	free(self->rank);
+	destroy_csr_graph(&self->up);
+	destroy_csr_graph(&self->down);
+	free(self->upMiddle);
+	free(self->downMiddle);
+	self->V = 0;
+}
+
+/* Helper function which finds arc a->b in the hierarchy
+	Returns its slot, and sets *middle to its bypassed vertex (-1 for an original edge)
+**************************************************************************/
+static int ch_find_arc(ContractionHierarchy *self, int a, int b, int *middle) {
+
+	int upward = self->rank[a] < self->rank[b];
+	CsrGraph *g = upward ? &self->up : &self->down;
+	int at = upward ? a : b;
+	int to = upward ? b : a;
+
+	for (int e = g->offsets[at]; e < g->offsets[at + 1]; e++) {
+		if (g->to_vertex[e] == to) {
+			*middle = upward ? self->upMiddle[e] : self->downMiddle[e];
+			return e;
+		}
+	}
+	*middle = -1;
+	return -1;
+}
+
+/* Helper function which expands arc a->b into original edges, appending every vertex
+	after a to path (or only counting them once path is full)
+	Returns new path length
+**************************************************************************/
+static int ch_unpack(ContractionHierarchy *self, int a, int b, int *path, int capacity, int length) {
+
+	int stackSize = 16;
+	int *stack = malloc(stackSize * 2 * sizeof(int));
+	int top = 1;
+
+	stack[0] = a;
+	stack[1] = b;
+	while (top > 0) {
+		top--;
+		int from = stack[2 * top];
+		int to = stack[2 * top + 1];
+		int middle;
+		ch_find_arc(self, from, to, &middle);
+
+		if (middle == -1) {
+			if (length < capacity) {
+				path[length] = to;
+			}
+			length++;
+			continue;
+		}
+		if (top + 2 > stackSize) {
+			stackSize *= 2;
+			stack = realloc(stack, stackSize * 2 * sizeof(int));
+		}
+		stack[2 * top] = middle;			// middle->to is expanded after from->middle
+		stack[2 * top + 1] = to;
+		stack[2 * top + 2] = from;
+		stack[2 * top + 3] = middle;
+		top += 2;
+	}
+
+	free(stack);
+	return length;
+}
+
+/* Point-to-point query on a contraction hierarchy
+	Takes hierarchy, two workspaces built for self->V vertices, source and target, and
+	optional path buffer (capacity entries; may be NULL)
+
+	Searches upwards in rank from source (over 'up') and from target (over 'down'), each
+	side stopping once its queue minimum reaches the best meeting distance found.
+	Returns distance (INT_MAX if unreachable). *pathLength receives the number of
+	vertices written to path, from source to target with shortcuts unpacked into
+	original edges, or 0 if path is NULL, too small, or target is unreachable.
+*********************************************************************************************/
+int ch_query(ContractionHierarchy *self, Workspace *forward, Workspace *backward,
+	int source, int target, int *path, int capacity, int *pathLength) {
+
+	Workspace *ws[2] = { forward, backward };
+	CsrGraph *graph[2] = { &self->up, &self->down };
+	int start[2] = { source, target };
+
+	for (int side = 0; side < 2; side++) {
+		workspace_begin(ws[side]);
+		ws[side]->reached[start[side]] = ws[side]->generation;
+		ws[side]->distance[start[side]] = 0;
+		ws[side]->previous[start[side]] = -1;
+		heap_push(&ws[side]->queue, start[side], 0);
+	}
+
+	long long best = LLONG_MAX;
+	int meet = -1;
+
+	while (1) {
+		long long minimum[2];
+		for (int side = 0; side < 2; side++) {
+			minimum[side] = heap_is_empty(&ws[side]->queue) ? LLONG_MAX : heap_min_key(&ws[side]->queue);
+		}
+		if (minimum[0] >= best && minimum[1] >= best) {		// Neither side can improve
+			break;
+		}
+
+		int side = minimum[0] <= minimum[1] ? 0 : 1;
+		Workspace *w = ws[side];
+		Workspace *other = ws[1 - side];
+		int v = heap_pop(&w->queue);
+		w->settled[v] = w->generation;
+
+		int otherDistance = workspace_distance(other, v);
+		if (otherDistance != INT_MAX && (long long)w->distance[v] + otherDistance < best) {
+			best = (long long)w->distance[v] + otherDistance;
+			meet = v;
+		}
+
+		CsrGraph *g = graph[side];
+		for (int e = g->offsets[v]; e < g->offsets[v + 1]; e++) {
+			int to = g->to_vertex[e];
+			if (w->settled[to] == w->generation) {
+				continue;
+			}
+			int alt = w->distance[v] + g->weight[e];
+			if (w->reached[to] != w->generation || alt < w->distance[to]) {
+				w->reached[to] = w->generation;
+				w->distance[to] = alt;
+				w->previous[to] = v;
+				heap_push(&w->queue, to, alt);
+			}
+		}
+	}
+
+	if (pathLength != NULL) {
+		*pathLength = 0;
+	}
+	if (meet == -1) {
+		return INT_MAX;
+	}
+
+	if (path != NULL && pathLength != NULL) {
+		// Hierarchy path: source..meet from forward parents, then meet..target
+		int upHops = 0, hops = 0;
+		for (int v = meet; v != -1; v = forward->previous[v]) {
+			upHops++;
+		}
+		hops = upHops;
+		for (int v = backward->previous[meet]; v != -1; v = backward->previous[v]) {
+			hops++;
+		}
+		int *route = malloc(hops * sizeof(int));
+		int i = upHops;
+		for (int v = meet; v != -1; v = forward->previous[v]) {
+			route[--i] = v;
+		}
+		i = upHops;
+		for (int v = backward->previous[meet]; v != -1; v = backward->previous[v]) {
+			route[i++] = v;
+		}
+
+		int length = 1;
+		if (capacity > 0) {
+			path[0] = route[0];
+		}
+		for (int k = 0; k + 1 < hops; k++) {
+			length = ch_unpack(self, route[k], route[k + 1], path, capacity, length);
+		}
+		*pathLength = length <= capacity ? length : 0;
+		free(route);
+	}
+
+	return (int)best;
+}
+
+/* Writes hierarchy to a binary file
+	Layout: magic, version, V, up arc count, down arc count (uint32 each), then the
+	int32 arrays rank, up (offsets, to_vertex, weight, middle), down (the same)
+	Returns 1 on success, 0 on failure
+*********************************************************************************************/
+int save_contraction_hierarchy(const char *path, ContractionHierarchy *self) {
+
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		return 0;
+	}
+
+	uint32_t header[4] = { CH_VERSION, (uint32_t)self->V, (uint32_t)self->up.E, (uint32_t)self->down.E };
+	size_t v = self->V;
+	int ok = fwrite(CH_MAGIC, 1, 4, f) == 4
+		&& fwrite(header, sizeof header, 1, f) == 1
+		&& fwrite(self->rank, sizeof(int), v, f) == v
+		&& fwrite(self->up.offsets, sizeof(int), v + 1, f) == v + 1
+		&& fwrite(self->up.to_vertex, sizeof(int), self->up.E, f) == (size_t)self->up.E
+		&& fwrite(self->up.weight, sizeof(int), self->up.E, f) == (size_t)self->up.E
+		&& fwrite(self->upMiddle, sizeof(int), self->up.E, f) == (size_t)self->up.E
+		&& fwrite(self->down.offsets, sizeof(int), v + 1, f) == v + 1
+		&& fwrite(self->down.to_vertex, sizeof(int), self->down.E, f) == (size_t)self->down.E
+		&& fwrite(self->down.weight, sizeof(int), self->down.E, f) == (size_t)self->down.E
+		&& fwrite(self->downMiddle, sizeof(int), self->down.E, f) == (size_t)self->down.E;
+
+	if (fclose(f) != 0) {
+		ok = 0;
+	}
+	return ok;
+}
+
+/* Helper function which checks one side of a loaded hierarchy: offsets must run from
+	0 to E without decreasing, and every arc must lead to a higher-ranked vertex and
+	bypass (if a shortcut) a vertex ranked below both ends, so unpacking terminates
+**************************************************************************/
+static int ch_side_valid(ContractionHierarchy *self, CsrGraph *graph, int *middle) {
+
+	if (graph->offsets[0] != 0 || graph->offsets[self->V] != graph->E) {
+		return 0;
+	}
+	for (int at = 0; at < self->V; at++) {
+		if (graph->offsets[at + 1] < graph->offsets[at]) {
+			return 0;
+		}
+		for (int e = graph->offsets[at]; e < graph->offsets[at + 1]; e++) {
+			int to = graph->to_vertex[e];
+			if (to < 0 || to >= self->V || self->rank[to] <= self->rank[at]
+				|| middle[e] < -1 || middle[e] >= self->V
+				|| (middle[e] != -1 && self->rank[middle[e]] >= self->rank[at])) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Helper function which checks a loaded hierarchy before it is searched
+	Returns 1 if rank is a permutation of [0, V) and both sides are valid
+**************************************************************************/
+static int ch_valid(ContractionHierarchy *self) {
+
+	char *seen = calloc(self->V, 1);
+	int ok = 1;
+	for (int v = 0; ok && v < self->V; v++) {
+		ok = self->rank[v] >= 0 && self->rank[v] < self->V && !seen[self->rank[v]];
+		if (ok) {
+			seen[self->rank[v]] = 1;
+		}
+	}
+	free(seen);
+	return ok && ch_side_valid(self, &self->up, self->upMiddle) && ch_side_valid(self, &self->down, self->downMiddle);
+}
+
+/* Reads hierarchy written by save_contraction_hierarchy()
+	Returns 1 on success, or 0 (leaving 'out' empty) on failure, including a file
+	whose arcs, shortcuts or ranks are not a valid hierarchy
+*********************************************************************************************/
+int load_contraction_hierarchy(const char *path, ContractionHierarchy *out) {
+
+	memset(out, 0, sizeof *out);
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		return 0;
+	}
+
+	char magic[4];
+	uint32_t header[4];
+	if (fread(magic, 1, 4, f) != 4 || memcmp(magic, CH_MAGIC, 4) != 0
+		|| fread(header, sizeof header, 1, f) != 1 || header[0] != CH_VERSION
+		|| header[1] >= INT_MAX || header[2] >= INT_MAX || header[3] >= INT_MAX) {
+		fclose(f);
+		return 0;
+	}
+
+	// Counts must describe exactly the rest of the file before anything is allocated
+	uint64_t expected = 4 + sizeof header
+		+ sizeof(int) * (3 * (uint64_t)header[1] + 2 + 3 * (uint64_t)header[2] + 3 * (uint64_t)header[3]);
+	long start = ftell(f);
+	int sized = start >= 0 && fseek(f, 0, SEEK_END) == 0;
+	long end = sized ? ftell(f) : -1;
+	if (end < 0 || (uint64_t)end != expected || fseek(f, start, SEEK_SET) != 0) {
+		fclose(f);
+		return 0;
+	}
+
+	size_t v = header[1];
+	out->V = (int)v;
+	out->rank = malloc(v * sizeof(int));
+	out->up = new_csr_graph(out->V, (int)header[2]);
+	out->upMiddle = malloc(header[2] * sizeof(int));
+	out->down = new_csr_graph(out->V, (int)header[3]);
+	out->downMiddle = malloc(header[3] * sizeof(int));
+
+	int ok = fread(out->rank, sizeof(int), v, f) == v
+		&& fread(out->up.offsets, sizeof(int), v + 1, f) == v + 1
+		&& fread(out->up.to_vertex, sizeof(int), header[2], f) == header[2]
+		&& fread(out->up.weight, sizeof(int), header[2], f) == header[2]
+		&& fread(out->upMiddle, sizeof(int), header[2], f) == header[2]
+		&& fread(out->down.offsets, sizeof(int), v + 1, f) == v + 1
+		&& fread(out->down.to_vertex, sizeof(int), header[3], f) == header[3]
+		&& fread(out->down.weight, sizeof(int), header[3], f) == header[3]
+		&& fread(out->downMiddle, sizeof(int), header[3], f) == header[3];
+	fclose(f);
+	ok = ok && ch_valid(out);
+
+	if (!ok) {
+		destroy_contraction_hierarchy(out);
+		memset(out, 0, sizeof *out);
+	}
+	return ok;
+}
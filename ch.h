@@ -0,0 +1,35 @@
+#pragma once
+#include "graph.h"
+#include "batch.h"
+
+/* Contraction hierarchy over a graph with non-negative weights.
+	Vertices are contracted one at a time (rank = order of contraction); contracting v
+	adds a shortcut u->w via v wherever u->v->w is the only shortest u->w path among
+	the vertices left. Every shortest path then exists as a path which only climbs in
+	rank and then only descends, so queries search upwards from both ends.
+
+	Each arc (original edge or shortcut) is kept once, in 'up' at its lower-ranked end:
+		up:		arc u->w with rank[u] < rank[w], stored at u
+		down:	arc u->w with rank[u] > rank[w], stored at w pointing to u
+	middle = contracted vertex a shortcut bypasses, or -1 for an original edge.
+**************************************************************************/
+typedef struct contractionHierarchy {
+	int V;
+	int *rank;
+	CsrGraph up;
+	int *upMiddle;
+	CsrGraph down;
+	int *downMiddle;
+} ContractionHierarchy;
+
+// Functions for building/destroying hierarchies
+ContractionHierarchy build_contraction_hierarchy(CsrGraph *graph);
+void destroy_contraction_hierarchy(ContractionHierarchy *self);
+
+// Functions for saving/loading hierarchies; return 1 on success, 0 on failure
+int save_contraction_hierarchy(const char *path, ContractionHierarchy *self);
+int load_contraction_hierarchy(const char *path, ContractionHierarchy *out);
+
+// Point-to-point query, using two workspaces of self->V vertices
+int ch_query(ContractionHierarchy *self, Workspace *forward, Workspace *backward,
+	int source, int target, int* path, int capacity, int* pathLength);
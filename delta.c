@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "delta.h"
+
+/* Growable array of vertices, used for buckets and per-thread request buffers
+**************************************************************************/
+typedef struct vertexList {
+	int count;
+	int capacity;
+	int *vertices;
+} VertexList;
+
+static void list_append(VertexList *list, int vertex) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 64;
+		list->vertices = realloc(list->vertices, list->capacity * sizeof(int));
+	}
+	list->vertices[list->count++] = vertex;
+}
+
+/* Tentative distance and previous vertex of each vertex are packed into one 64-bit label,
+	distance in the high half, so both are updated by a single atomic minimum.
+	Equal distances resolve to the smaller previous vertex whatever order threads run in,
+	except over zero-weight edges: those only replace a label with a lower distance, or
+	two vertices at the same distance could end up as each other's previous vertex.
+**************************************************************************/
+typedef unsigned long long Label;
+
+#define LABEL_DISTANCE 0xFFFFFFFF00000000ull
+
+static Label make_label(int distance, int previous) {
+	return ((Label)(unsigned)distance << 32) | (unsigned)previous;
+}
+
+static int label_distance(Label label) {
+	return (int)(label >> 32);
+}
+
+static Label load_label(Label *slot) {
+#if defined(__GNUC__)
+	return __atomic_load_n(slot, __ATOMIC_RELAXED);
+#else
+	Label value;
+	#pragma omp atomic read
+	value = *slot;
+	return value;
+#endif
+}
+
+/* Lowers *slot to value if value is smaller; if strict, only if its distance is smaller
+	Returns 1 if *slot was changed
+**************************************************************************/
+static int atomic_min_label(Label *slot, Label value, int strict) {
+	Label mask = strict ? LABEL_DISTANCE : ~0ull;
+#if defined(__GNUC__)
+	Label current = __atomic_load_n(slot, __ATOMIC_RELAXED);
+	while (value < (current & mask)) {
+		if (__atomic_compare_exchange_n(slot, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			return 1;
+		}
+	}
+	return 0;
+#else
+	int changed = 0;
+	#pragma omp critical(delta_label)
+	{
+		if (value < (*slot & mask)) {
+			*slot = value;
+			changed = 1;
+		}
+	}
+	return changed;
+#endif
+}
+
+/* Helper function for delta_stepping_csr(); relaxes the light (weight <= delta) or heavy
+	edges of every vertex in list in parallel. Vertices whose label improved are recorded
+	in the calling thread's 'improved' list.
+**************************************************************************/
+static void relax_edges(CsrGraph *self, VertexList *list, int heavy, int delta, Label *label,
+	VertexList *improved, int threads) {
+
+	#pragma omp parallel for num_threads(threads) schedule(dynamic, 64)
+	for (int i = 0; i < list->count; i++) {
+#ifdef _OPENMP
+		VertexList *out = &improved[omp_get_thread_num()];
+#else
+		VertexList *out = &improved[0];
+#endif
+		int u = list->vertices[i];
+		int distU = label_distance(load_label(&label[u]));
+		for (int e = self->offsets[u]; e < self->offsets[u + 1]; e++) {
+			int w = self->weight[e];
+			if ((w > delta) != heavy) {
+				continue;
+			}
+			int to = self->to_vertex[e];
+			if (atomic_min_label(&label[to], make_label(distU + w, u), w == 0)) {
+				list_append(out, to);
+			}
+		}
+	}
+}
+
+/* Chooses a bucket width for delta_stepping_csr(): the mean edge weight (at least 1)
+	Larger delta means fewer, bigger parallel phases but more repeated relaxations
+*********************************************/
+int delta_default(CsrGraph *self) {
+
+	long long total = 0;
+	for (int e = 0; e < self->E; e++) {
+		total += self->weight[e];
+	}
+	int delta = self->E > 0 ? (int)(total / self->E) : 1;
+	return delta < 1 ? 1 : delta;
+}
+
+/* Delta-stepping shortest paths
+	Takes a CSR graph with non-negative weights, source vertex, two arrays of length =
+	vertex count, bucket width (<= 0 uses delta_default()), and thread count
+	(<= 0 uses every available core)
+
+	Same contract as dijkstra(); where several shortest paths exist, 'previous' holds the
+	lowest-numbered predecessor (reached over a non-zero edge, see Label). Graphs with
+	negative weights are passed to dijkstra_csr().
+
+	Vertices are kept in buckets of width delta by tentative distance. The lowest
+	non-empty bucket is emptied by repeatedly relaxing the light edges (weight <= delta)
+	of all its vertices in parallel, which may refill it; the heavy edges of every vertex
+	removed from the bucket are then relaxed once, also in parallel. Distance/previous
+	pairs are updated with an atomic minimum, and each thread collects the vertices it
+	improved so buckets are only modified between parallel phases.
+*********************************************************************************************/
+void delta_stepping_csr(CsrGraph *self, int source, int *distance, int *previous, int delta, int threads) {
+
+	int vertexCount = self->V;
+	int maxWeight = 0;
+
+	for (int e = 0; e < self->E; e++) {
+		if (self->weight[e] < 0) {
+			dijkstra_csr(self, source, distance, previous);
+			return;
+		}
+		maxWeight = self->weight[e] > maxWeight ? self->weight[e] : maxWeight;
+	}
+	if (delta <= 0) {
+		delta = delta_default(self);
+	}
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+
+	// Tentative distances lie within maxWeight of the current bucket, so buckets are reused
+	int bucketCount = maxWeight / delta + 2;
+	VertexList *bucket = calloc(bucketCount, sizeof(VertexList));
+	VertexList *improved = calloc(threads, sizeof(VertexList));	// Per-thread output
+	VertexList frontier = { 0, 0, NULL };
+	VertexList removed = { 0, 0, NULL };		// Vertices taken from current bucket
+	Label *label = malloc(vertexCount * sizeof(Label));
+	int *removedIn = malloc(vertexCount * sizeof(int));			// Bucket vertex was last removed from
+	int *stamp = malloc(vertexCount * sizeof(int));				// Light phase vertex was last queued in
+	int phase = 0;
+
+	for (int v = 0; v < vertexCount; v++) {
+		label[v] = make_label(INT_MAX, -1);
+		removedIn[v] = -1;
+		stamp[v] = -1;
+	}
+	label[source] = make_label(0, -1);
+	list_append(&bucket[0], source);
+	int pending = 1;				// Entries in all buckets, including stale ones
+
+	for (int current = 0; pending > 0; current++) {
+		VertexList *now = &bucket[current % bucketCount];
+		removed.count = 0;
+
+		while (now->count > 0 || removed.count > 0) {
+			int heavy = now->count == 0;
+
+			if (heavy) {						// Bucket settled; relax heavy edges once
+				VertexList swap = frontier;
+				frontier = removed;
+				removed = swap;
+				removed.count = 0;
+			}
+			else {								// Take current bucket, dropping stale entries
+				frontier.count = 0;
+				phase++;
+				for (int i = 0; i < now->count; i++) {
+					int v = now->vertices[i];
+					if (label_distance(label[v]) / delta == current && stamp[v] != phase) {
+						stamp[v] = phase;
+						list_append(&frontier, v);
+						if (removedIn[v] != current) {
+							removedIn[v] = current;
+							list_append(&removed, v);
+						}
+					}
+				}
+				pending -= now->count;
+				now->count = 0;
+			}
+
+			relax_edges(self, &frontier, heavy, delta, label, improved, threads);
+
+			for (int t = 0; t < threads; t++) {	// File improved vertices into buckets
+				for (int i = 0; i < improved[t].count; i++) {
+					int v = improved[t].vertices[i];
+					list_append(&bucket[(label_distance(label[v]) / delta) % bucketCount], v);
+				}
+				pending += improved[t].count;
+				improved[t].count = 0;
+			}
+		}
+	}
+
+	for (int v = 0; v < vertexCount; v++) {
+		distance[v] = label_distance(label[v]);
+		previous[v] = (int)(unsigned)(label[v] & 0xFFFFFFFFu);
+	}
+
+	for (int b = 0; b < bucketCount; b++) {
+		free(bucket[b].vertices);
+	}
+	for (int t = 0; t < threads; t++) {
+		free(improved[t].vertices);
+	}
+	free(bucket);
+	free(improved);
+	free(frontier.vertices);
+	free(removed.vertices);
+	free(label);
+	free(removedIn);
+	free(stamp);
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "graph.h"
+
+// Parallel single-source shortest paths by delta-stepping
+void delta_stepping_csr(CsrGraph *self, int source, int* distance, int* previous, int delta, int threads);
+int delta_default(CsrGraph *self);
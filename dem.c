@@ -0,0 +1,410 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "dem.h"
+#include "stats.h"
+
+static int dem_noise(unsigned seed, int x, int y, int r);
+static int dem_point(int* heights, int size, int x, int y, int step, int r, unsigned seed);
+static int clamp_height(int height);
+
+
+/* Map code
+******************/
+int** make_dem(int size, int roughness) {
+	return make_dem_seeded(size, roughness, (unsigned)time(NULL));
+}
+
+/* As make_dem(), but seeded explicitly so the same seed always gives the same DEM
+*************************************************************************************/
+int** make_dem_seeded(int size, int roughness, unsigned seed) {
+	srand(seed);
+	int** dem = malloc(size * sizeof *dem);
+	for (int x = 0; x < size; x++) {
+		dem[x] = malloc(size * sizeof *dem[x]);
+		for (int y = 0; y < size; y++) {
+			dem[x][y] = -1;
+		}
+	}
+	int r = roughness;
+
+	dem[0][0] = 50 - r / 2 + rand() % r;
+	dem[size - 1][0] = 50 - r / 2 + rand() % r;
+	dem[0][size - 1] = 50 - r / 2 + rand() % r;
+	dem[size - 1][size - 1] = 50 - r / 2 + rand() % r;
+
+	for (int step = (size - 1); step > 0; step /= 2) {
+		r = r > 1 ? r / 2 : r;
+		if (r < 1) r = 1;
+		for (int cx = 0; cx < (size - 1) / step; cx++) {
+			for (int cy = 0; cy < (size - 1) / step; cy++) {
+				int a = dem[cx*step][cy*step];
+				int b = dem[cx*step + step][cy*step];
+				int c = dem[cx*step][cy*step + step];
+				int d = dem[cx*step + step][cy*step + step];
+
+				dem[cx*step + step / 2][cy*step + step / 2] = (a + b + c + d) / 4 + rand() % r - r / 2;
+
+				dem[cx*step + step / 2][cy*step] = (a + b) / 2 + rand() % r - r / 2;
+				dem[cx*step][cy*step + step / 2] = (a + c) / 2 + rand() % r - r / 2;
+				dem[cx*step + step][cy*step + step / 2] = (b + d) / 2 + rand() % r - r / 2;
+				dem[cx*step + step / 2][cy*step + step] = (c + d) / 2 + rand() % r - r / 2;
+			}
+		}
+	}
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+			dem[x][y] = dem[x][y]<0 ? 0 : dem[x][y];
+			dem[x][y] = dem[x][y]>99 ? 99 : dem[x][y];
+		}
+	}
+	return dem;
+}
+
+/* Parallel DEM generator
+	Takes size (2^n + 1), roughness, seed, and thread count (<= 0 uses every available core)
+	Returns heights (0-99) in one flat row-major buffer of size * size; height of
+	cell (x, y) is heights[x * size + y]. Caller frees buffer.
+
+	Same diamond-square scheme as make_dem(), but each level's new points are
+	written exactly once, with noise drawn from a hash of (seed, x, y) rather than
+	rand(), so the DEM depends only on the seed, not on thread count or order.
+	New points on a level only read points from earlier levels, so each level is
+	one parallel loop. Clamping to 0-99 is done during the last level.
+*********************************************************************************************/
+int* make_dem_flat(int size, int roughness, unsigned seed, int threads) {
+
+	int* heights = malloc((size_t)size * size * sizeof *heights);
+	int r = roughness;
+
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+
+	int last = size - 1;
+	heights[0] = 50 + dem_noise(seed, 0, 0, r);		// 50 - r/2 + (0..r-1), as make_dem()
+	heights[(size_t)last * size] = 50 + dem_noise(seed, last, 0, r);
+	heights[last] = 50 + dem_noise(seed, 0, last, r);
+	heights[(size_t)last * size + last] = 50 + dem_noise(seed, last, last, r);
+
+	if (size < 3) {						// Corners only
+		for (int i = 0; i < size * size; i++) {
+			heights[i] = clamp_height(heights[i]);
+		}
+		return heights;
+	}
+
+	for (int step = size - 1; step > 2; step /= 2) {
+		r = r > 1 ? r / 2 : r;
+		int half = step / 2;
+
+		// Rows holding new points: every multiple of half
+		#pragma omp parallel for num_threads(threads) schedule(static)
+		for (int x = 0; x < size; x += half) {
+			int start = x % step == 0 ? half : 0;		// Corner rows only gain midpoints
+			int stride = x % step == 0 ? step : half;
+			for (int y = start; y < size; y += stride) {
+				heights[(size_t)x * size + y] = dem_point(heights, size, x, y, step, r, seed);
+			}
+		}
+	}
+
+	// Last level (step 2): odd rows only read even rows, so compute them first...
+	r = r > 1 ? r / 2 : r;
+	#pragma omp parallel for num_threads(threads) schedule(static)
+	for (int x = 1; x < size; x += 2) {
+		for (int y = 0; y < size; y++) {
+			heights[(size_t)x * size + y] = clamp_height(dem_point(heights, size, x, y, 2, r, seed));
+		}
+	}
+	// ...then even rows, whose new points only read their own row, clamping old points as we go
+	#pragma omp parallel for num_threads(threads) schedule(static)
+	for (int x = 0; x < size; x += 2) {
+		int* row = heights + (size_t)x * size;
+		for (int y = 1; y < size; y += 2) {
+			row[y] = clamp_height(dem_point(heights, size, x, y, 2, r, seed));
+		}
+		for (int y = 0; y < size; y += 2) {
+			row[y] = clamp_height(row[y]);
+		}
+	}
+
+	return heights;
+}
+
+/* Returns an array of row pointers into a flat DEM (caller frees the array only),
+	so it can be passed to functions taking an int** DEM
+*********************************************************************************************/
+int** dem_rows(int* heights, int size) {
+
+	int** dem = malloc(size * sizeof *dem);
+	for (int x = 0; x < size; x++) {
+		dem[x] = heights + (size_t)x * size;
+	}
+	return dem;
+}
+
+/* Helper function for make_dem_flat(); counter-based random noise in [-r/2, r - r/2)
+	Same seed and cell always give the same value, whichever thread asks
+*********************************************************************************************/
+static int dem_noise(unsigned seed, int x, int y, int r) {
+
+	uint64_t z = ((uint64_t)(unsigned)x << 32 | (unsigned)y) ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;		// splitmix64 finaliser
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	z ^= z >> 31;
+	return (int)(z % (uint64_t)r) - r / 2;
+}
+
+/* Helper function for make_dem_flat(); value of new point (x, y) on the level with 'step'
+	Square centres average their four corners; edge midpoints average their two ends
+*********************************************************************************************/
+static int dem_point(int* heights, int size, int x, int y, int step, int r, unsigned seed) {
+
+	int half = step / 2;
+	int xMid = x % step != 0;
+	int yMid = y % step != 0;
+	int value;
+
+	if (xMid && yMid) {				// Centre of square
+		value = (heights[(size_t)(x - half) * size + y - half] + heights[(size_t)(x + half) * size + y - half]
+			+ heights[(size_t)(x - half) * size + y + half] + heights[(size_t)(x + half) * size + y + half]) / 4;
+	}
+	else if (xMid) {				// Midpoint of vertical edge
+		value = (heights[(size_t)(x - half) * size + y] + heights[(size_t)(x + half) * size + y]) / 2;
+	}
+	else {							// Midpoint of horizontal edge
+		value = (heights[(size_t)x * size + y - half] + heights[(size_t)x * size + y + half]) / 2;
+	}
+	return value + dem_noise(seed, x, y, r);
+}
+
+static int clamp_height(int height) {
+	return height < 0 ? 0 : (height > 99 ? 99 : height);
+}
+
+int cost_funcA(int diff) {
+	int cost = 1;
+	if (diff > 0) cost += diff * diff;
+	return cost;
+}
+
+int cost_funcB(int diff) {
+	int cost = 1;
+	if (diff > 0)
+		cost += diff * diff;
+	else
+		cost += diff;
+	return cost;
+}
+
+void print_2D(int** array2D, int size) {
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+			if (array2D[x][y] >= 0) {
+				printf("%2d ", array2D[x][y]);
+			}
+			else {
+				printf("() ");
+			}
+		}
+		printf("\n");
+	}
+}
+
+void print_2D_ascii(int** array2D, int size) {
+	char *shades = " .-:=+*#%@";
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+			if (array2D[x][y] >= 0) {
+				char shade = shades[array2D[x][y] * 10 / 100];
+				printf("%c%c", shade, shade);
+			}
+			else {
+				printf("()");
+			}
+		}
+		printf("\n");
+	}
+}
+
+/* Frees a DEM made by make_dem() or copy_dem()
+************************************************/
+void free_dem(int** array2D, int size) {
+	for (int i = 0; i < size; i++) {
+		free(array2D[i]);
+	}
+	free(array2D);
+}
+
+
+/* Helper function used when tracing shortest paths
+   Takes a dem, copies it, returns copy
+****************************************************/
+int** copy_dem(int** array2D, int size) {
+
+	int** copy = malloc(size * sizeof *copy);
+	for (int x = 0; x < size; x++) {
+		copy[x] = malloc(size * sizeof *copy[x]);
+		for (int y = 0; y < size; y++) {
+			copy[x][y] = array2D[x][y];
+		}
+	}
+
+	return copy;
+}
+
+/* Takes an empty graph, a DEM, size, and an integer either 0 or != 0.
+
+   Function calculates all possible moves from each vertex [x][y] location of DEM,
+   and adds those edges to the graph using possibleMove() helper function.
+
+   Weights of edges are calculated by possibleMove where:
+
+			allowNegativeWeights = 0,	uses cost_funcA() (edge weights > 0)
+			allowNegativeWeights != 0,	uses cost_funcB() (allows negative edge weights)
+*****************************************************************************************/
+void build_graph(Graph self, int** array2D, int size, int allowNegativeWeights) {
+	STATS_TIMER_START(timer);
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+
+			int sourceVertex = x * size + y;
+			int sourceValue = array2D[x][y];
+
+			if (x != 0) {
+				// Can move 'North'
+				possibleMove(self, array2D, size, sourceVertex, sourceValue, x - 1, y, allowNegativeWeights);
+			}
+			if (x != size - 1) {
+				// Can move 'South'
+				possibleMove(self, array2D, size, sourceVertex, sourceValue, x + 1, y, allowNegativeWeights);
+			}
+			if (y != 0) {
+				// Can move 'West'
+				possibleMove(self, array2D, size, sourceVertex, sourceValue, x, y - 1, allowNegativeWeights);
+			}
+			if (y != size - 1) {
+				// Can move 'East'
+				possibleMove(self, array2D, size, sourceVertex, sourceValue, x, y + 1, allowNegativeWeights);
+			}
+
+		}
+	}
+	STATS_TIMER_STOP(timer, buildSeconds);
+}
+
+/* Helper function for buid_graph function above.
+Takes Graph, DEM, size, source vertex, its value, x and y values, and integer to allow for negative weights
+Adds edge from source vertex to destination vertex, costed according to 'allowNegativeWeights'
+*****************************************************************************************************************/
+void possibleMove(Graph self, int** array2D, int size, int sourceVertex, int sourceValue, int x, int y, int allowNegativeWeights) {
+
+	int destinationVertex = x * size + y;
+	int cost = move_cost(sourceValue, array2D[x][y], allowNegativeWeights);
+
+	add_edge(&self, sourceVertex, destinationVertex, cost);
+}
+
+
+/* Calculates cost of moving between two heights where:
+
+			allowNegativeWeights = 0,	uses cost_funcA() (edge weights > 0)
+			allowNegativeWeights != 0,	uses cost_funcB() (allows negative edge weights)
+*****************************************************************************************/
+int move_cost(int sourceValue, int destinationValue, int allowNegativeWeights) {
+
+	if (allowNegativeWeights == 0) {		// Edge weights > 0
+		return cost_funcA(destinationValue - sourceValue);
+	}
+	else {									// Negative weights permitted
+		return cost_funcB(destinationValue - sourceValue);
+	}
+}
+
+/* Builds a CSR graph directly from a DEM, without per-edge allocation.
+   Takes DEM, size, and allowNegativeWeights (as for build_graph())
+
+   Produces the same edges and weights as build_graph(), in the same adjacency order
+   (East, West, South, North), so print_csr_graph() matches print_graph().
+*****************************************************************************************/
+CsrGraph build_csr_graph(int** array2D, int size, int allowNegativeWeights) {
+	return build_csr_graph_parallel(array2D, size, allowNegativeWeights, 1);
+}
+
+/* Builds a CSR graph from a DEM across threads (threads <= 0 uses every core)
+   Each row's edges are counted independently, a prefix sum over rows gives where each
+   row's edges start, and rows are then filled independently. The result is identical
+   to build_csr_graph() for any thread count.
+*****************************************************************************************/
+CsrGraph build_csr_graph_parallel(int** array2D, int size, int allowNegativeWeights, int threads) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = size * size;
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+
+	// rowStart[x] = first edge leaving row x
+	int *rowStart = malloc((size + 1) * sizeof(int));
+	rowStart[0] = 0;
+
+	#pragma omp parallel for num_threads(threads) schedule(static)
+	for (int x = 0; x < size; x++) {
+		int count = 0;
+		for (int y = 0; y < size; y++) {
+			count += (y != size - 1) + (y != 0) + (x != size - 1) + (x != 0);
+		}
+		rowStart[x + 1] = count;
+	}
+	for (int x = 0; x < size; x++) {
+		rowStart[x + 1] += rowStart[x];
+	}
+
+	CsrGraph graph = new_csr_graph(vertexCount, rowStart[size]);
+
+	#pragma omp parallel for num_threads(threads) schedule(static)
+	for (int x = 0; x < size; x++) {
+		int e = rowStart[x];
+		for (int y = 0; y < size; y++) {
+
+			int sourceVertex = x * size + y;
+			int sourceValue = array2D[x][y];
+			graph.offsets[sourceVertex] = e;
+
+			if (y != size - 1) {	// 'East'
+				graph.to_vertex[e] = sourceVertex + 1;
+				graph.weight[e++] = move_cost(sourceValue, array2D[x][y + 1], allowNegativeWeights);
+			}
+			if (y != 0) {			// 'West'
+				graph.to_vertex[e] = sourceVertex - 1;
+				graph.weight[e++] = move_cost(sourceValue, array2D[x][y - 1], allowNegativeWeights);
+			}
+			if (x != size - 1) {	// 'South'
+				graph.to_vertex[e] = sourceVertex + size;
+				graph.weight[e++] = move_cost(sourceValue, array2D[x + 1][y], allowNegativeWeights);
+			}
+			if (x != 0) {			// 'North'
+				graph.to_vertex[e] = sourceVertex - size;
+				graph.weight[e++] = move_cost(sourceValue, array2D[x - 1][y], allowNegativeWeights);
+			}
+		}
+	}
+	graph.offsets[vertexCount] = rowStart[size];
+	free(rowStart);
+	STATS_TIMER_STOP(timer, buildSeconds);
+
+	return graph;
+}
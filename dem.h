@@ -0,0 +1,21 @@
+#pragma once
+#include "graph.h"
+
+// Map functions
+int** make_dem(int size, int roughness);
+int** make_dem_seeded(int size, int roughness, unsigned seed);
+int* make_dem_flat(int size, int roughness, unsigned seed, int threads);
+int** dem_rows(int* heights, int size);
+int** copy_dem(int** array2D, int size);
+void free_dem(int** array2D, int size);
+int cost_funcA(int diff);
+int cost_funcB(int diff);
+void print_2D(int** array2D, int size);
+void print_2D_ascii(int** array2D, int size);
+
+// Graph functions
+void build_graph(Graph self, int** array2D, int size, int allowNegativeWeights);
+void possibleMove(Graph self, int** array2D, int size, int sourceVertex, int sourceValue, int x, int y, int allowNegativeWeights);
+int move_cost(int sourceValue, int destinationValue, int allowNegativeWeights);
+CsrGraph build_csr_graph(int** array2D, int size, int allowNegativeWeights);
+CsrGraph build_csr_graph_parallel(int** array2D, int size, int allowNegativeWeights, int threads);
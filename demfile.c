@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "demfile.h"
+
+#define DEMFILE_ALIGN 64
+
+/* Helper function which rounds a byte offset up to the next section boundary
+*******************************************************************************/
+static uint64_t align_up(uint64_t offset) {
+	return (offset + DEMFILE_ALIGN - 1) / DEMFILE_ALIGN * DEMFILE_ALIGN;
+}
+
+/* Helper function which writes zero bytes until the file reaches offset
+*************************************************************************/
+static int pad_to(FILE *f, uint64_t offset) {
+	long position = ftell(f);
+	while (position >= 0 && (uint64_t)position < offset) {
+		if (fputc(0, f) == EOF) {
+			return 0;
+		}
+		position++;
+	}
+	return position >= 0;
+}
+
+/* Writes a DEM, and optionally a graph built from it, to a binary file
+	Takes path, DEM, size, graph (NULL to store heights only; otherwise it must have one
+	vertex per cell), and the cost function the graph's weights were built with
+	Returns 1 on success, 0 on failure
+*********************************************************************************************/
+int save_dem_file(const char *path, int** dem, int size, CsrGraph *graph, DemCost costModel) {
+
+	if (graph != NULL && (long long)graph->V != (long long)size * size) {
+		return 0;
+	}
+
+	DemFileHeader header;
+	memset(&header, 0, sizeof header);
+
+	uint64_t cells = (uint64_t)size * size;
+	memcpy(header.magic, DEMFILE_MAGIC, 4);
+	header.version = DEMFILE_VERSION;
+	header.byteOrder = DEMFILE_BYTE_ORDER;
+	header.rows = size;
+	header.cols = size;
+	header.hasGraph = graph != NULL;
+	header.costModel = graph != NULL ? costModel : DEM_COST_NONE;
+	header.vertexCount = cells;
+	header.edgeCount = graph != NULL ? graph->E : 0;
+	header.heightsOffset = align_up(sizeof header);
+	header.offsetsOffset = align_up(header.heightsOffset + cells * sizeof(int32_t));
+	header.toVertexOffset = align_up(header.offsetsOffset + (cells + 1) * sizeof(int32_t));
+	header.weightOffset = align_up(header.toVertexOffset + header.edgeCount * sizeof(int32_t));
+
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		return 0;
+	}
+
+	int ok = fwrite(&header, sizeof header, 1, f) == 1 && pad_to(f, header.heightsOffset);
+	for (int x = 0; ok && x < size; x++) {
+		ok = fwrite(dem[x], sizeof(int32_t), size, f) == (size_t)size;
+	}
+	if (ok && graph != NULL) {
+		ok = pad_to(f, header.offsetsOffset)
+			&& fwrite(graph->offsets, sizeof(int32_t), graph->V + 1, f) == (size_t)graph->V + 1
+			&& pad_to(f, header.toVertexOffset)
+			&& fwrite(graph->to_vertex, sizeof(int32_t), graph->E, f) == (size_t)graph->E
+			&& pad_to(f, header.weightOffset)
+			&& fwrite(graph->weight, sizeof(int32_t), graph->E, f) == (size_t)graph->E;
+	}
+
+	if (fclose(f) != 0) {
+		ok = 0;
+	}
+	return ok;
+}
+
+/* Helper function which checks that a section lies inside the file, on a section
+	boundary (so its int32 values are aligned)
+*********************************************************************/
+static int section_fits(uint64_t offset, uint64_t count, size_t length) {
+	return offset % DEMFILE_ALIGN == 0 && offset <= length && count <= (length - offset) / sizeof(int32_t);
+}
+
+/* Opens a DEM file read-only, mapping it into memory
+	Takes path, and DemFile to fill
+	Returns 1 on success, or 0 if the file cannot be read or is not a valid DEM file
+	of this version and byte order. Only the header and section bounds are checked, so
+	opening does not touch the sections; see dem_file_validate() for the stored graph
+*********************************************************************************************/
+int open_dem_file(const char *path, DemFile *out) {
+
+	memset(out, 0, sizeof *out);
+
+#ifndef _WIN32
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(DemFileHeader)) {
+		close(fd);
+		return 0;
+	}
+	out->length = (size_t)info.st_size;
+	out->data = mmap(NULL, out->length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);									// Mapping stays valid after close
+	if (out->data == MAP_FAILED) {
+		out->data = NULL;
+		return 0;
+	}
+	out->mapped = 1;
+#else
+	FILE *f = fopen(path, "rb");				// No mmap: read whole file instead
+	if (f == NULL) {
+		return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size < (long)sizeof(DemFileHeader)) {
+		fclose(f);
+		return 0;
+	}
+	out->length = (size_t)size;
+	out->data = malloc(out->length);
+	if (out->data == NULL || fread(out->data, 1, out->length, f) != out->length) {
+		fclose(f);
+		close_dem_file(out);
+		return 0;
+	}
+	fclose(f);
+	out->mapped = 0;
+#endif
+
+	DemFileHeader *h = out->data;
+	out->header = h;
+
+	int valid = memcmp(h->magic, DEMFILE_MAGIC, 4) == 0
+		&& h->version == DEMFILE_VERSION
+		&& h->byteOrder == DEMFILE_BYTE_ORDER
+		&& h->vertexCount == (uint64_t)h->rows * h->cols
+		&& h->vertexCount < INT_MAX
+		&& section_fits(h->heightsOffset, h->vertexCount, out->length);
+	if (valid && h->hasGraph) {
+		valid = h->edgeCount < INT_MAX
+			&& section_fits(h->offsetsOffset, h->vertexCount + 1, out->length)
+			&& section_fits(h->toVertexOffset, h->edgeCount, out->length)
+			&& section_fits(h->weightOffset, h->edgeCount, out->length);
+	}
+	if (!valid) {
+		close_dem_file(out);
+		return 0;
+	}
+
+	char *base = out->data;
+	out->heights = (int *)(base + h->heightsOffset);
+	out->hasGraph = h->hasGraph != 0;
+	if (out->hasGraph) {
+		out->graph.V = (int)h->vertexCount;
+		out->graph.E = (int)h->edgeCount;
+		out->graph.offsets = (int *)(base + h->offsetsOffset);
+		out->graph.to_vertex = (int *)(base + h->toVertexOffset);
+		out->graph.weight = (int *)(base + h->weightOffset);
+		csr_mark_changed(&out->graph);
+	}
+	return 1;
+}
+
+/* Checks an open file's stored graph before it is searched: offsets must run from 0
+	to E without decreasing, every edge must join two neighbouring cells of the DEM,
+	and cost_funcA graphs must have no negative weights
+	Reads the whole graph, so it costs one pass over those sections
+	Returns 1 if the graph is valid (or none is stored), 0 otherwise
+*********************************************************************************************/
+int dem_file_validate(DemFile *self) {
+
+	if (!self->hasGraph) {
+		return 1;
+	}
+	CsrGraph *graph = &self->graph;
+	int cols = (int)self->header->cols;
+	int noNegative = self->header->costModel == DEM_COST_A;
+
+	if (graph->offsets[0] != 0 || graph->offsets[graph->V] != graph->E) {
+		return 0;
+	}
+	for (int u = 0; u < graph->V; u++) {
+		if (graph->offsets[u + 1] < graph->offsets[u]) {
+			return 0;
+		}
+		for (int e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+			int to = graph->to_vertex[e];
+			int step = to - u;
+			if (to < 0 || to >= graph->V || (noNegative && graph->weight[e] < 0)
+				|| !(step == cols || step == -cols || ((step == 1 || step == -1) && to / cols == u / cols))) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* Closes a DEM file, unmapping it; its heights and graph become invalid
+**************************************************************************/
+void close_dem_file(DemFile *self) {
+
+	if (self->data != NULL) {
+#ifndef _WIN32
+		if (self->mapped) {
+			munmap(self->data, self->length);
+		}
+		else {
+			free(self->data);
+		}
+#else
+		free(self->data);
+#endif
+	}
+	memset(self, 0, sizeof *self);
+}
+
+/* Returns an array of row pointers into the file's heights (caller frees the array only)
+	so the mapped DEM can be passed to functions taking int** without copying it
+*******************************************************************************************/
+int** dem_file_rows(DemFile *self) {
+
+	int rows = (int)self->header->rows;
+	int cols = (int)self->header->cols;
+	int** dem = malloc(rows * sizeof *dem);
+
+	for (int x = 0; x < rows; x++) {
+		dem[x] = self->heights + (size_t)x * cols;
+	}
+	return dem;
+}
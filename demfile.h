@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "graph.h"
+
+/* Binary DEM file format (version 1)
+
+	header		DemFileHeader, at offset 0
+	heights		rows * cols int32, row-major
+	offsets		V + 1 int32		} optional CSR graph,
+	to_vertex	E int32			} present if hasGraph = 1
+	weight		E int32			}
+
+	Every section starts on a 64-byte boundary, and all values are in the byte order
+	of the machine that wrote the file (checked by byteOrder on opening). Files are
+	opened with mmap, so heights and graph are used in place without copying, and
+	processes opening the same file share its pages. Opening only checks the header;
+	dem_file_validate() checks a stored graph's contents before it is searched.
+**************************************************************************/
+#define DEMFILE_MAGIC "DEMG"
+#define DEMFILE_VERSION 1
+#define DEMFILE_BYTE_ORDER 0x01020304u
+
+// Cost function used for a stored graph's weights
+typedef enum demCost {
+	DEM_COST_NONE,		// No graph stored
+	DEM_COST_A,			// cost_funcA() (no negative weights)
+	DEM_COST_B,			// cost_funcB() (negative weights allowed)
+	DEM_COST_CUSTOM		// Some other cost function
+} DemCost;
+
+typedef struct demFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t hasGraph;
+	uint32_t costModel;		// DemCost
+	uint32_t reserved;
+	uint64_t vertexCount;
+	uint64_t edgeCount;
+	uint64_t heightsOffset;	// Byte offsets of each section from start of file
+	uint64_t offsetsOffset;
+	uint64_t toVertexOffset;
+	uint64_t weightOffset;
+} DemFileHeader;
+
+/* An open DEM file. heights and graph point into the (read-only) mapping,
+	and are valid until close_dem_file(); they must not be written to or freed.
+**************************************************************************/
+typedef struct demFile {
+	void *data;				// Start of mapping
+	size_t length;			// Bytes mapped
+	int mapped;				// 1 if data is an mmap, 0 if read into memory
+	DemFileHeader *header;
+	int *heights;			// rows * cols heights, row-major
+	int hasGraph;
+	CsrGraph graph;			// Stored graph (if hasGraph)
+} DemFile;
+
+// Functions for writing/reading DEM files; return 1 on success, 0 on failure
+int save_dem_file(const char *path, int** dem, int size, CsrGraph *graph, DemCost costModel);
+int open_dem_file(const char *path, DemFile *out);
+int dem_file_validate(DemFile *self);
+void close_dem_file(DemFile *self);
+
+// Row pointers into an open file's heights, for functions taking an int** DEM
+int** dem_file_rows(DemFile *self);
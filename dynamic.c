@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "dynamic.h"
+#include "dem.h"
+
+/* Helper function which finds edge from->to in graph
+	Returns edge number, or -1 if there is no such edge
+**************************************************************************/
+static int find_edge(CsrGraph *graph, int from, int to) {
+	for (int e = graph->offsets[from]; e < graph->offsets[from + 1]; e++) {
+		if (graph->to_vertex[e] == to) {
+			return e;
+		}
+	}
+	return -1;
+}
+
+/* Sets the weight of each edge in updates, recording its previous weight
+	Returns number of updates applied (edges which were not found are skipped,
+	with oldWeight = weight)
+**************************************************************************/
+int apply_edge_updates(CsrGraph *graph, EdgeUpdate *updates, int count) {
+
+	int applied = 0;
+	for (int i = 0; i < count; i++) {
+		int e = find_edge(graph, updates[i].from, updates[i].to);
+		if (e == -1) {
+			updates[i].oldWeight = updates[i].weight;
+			continue;
+		}
+		updates[i].oldWeight = graph->weight[e];
+		graph->weight[e] = updates[i].weight;
+		applied++;
+	}
+	if (applied > 0) {
+		csr_mark_changed(graph);
+	}
+	return applied;
+}
+
+/* Changes the heights of DEM cells, and re-costs only the edges into and out of them
+	Takes DEM and size, graph built from it by build_csr_graph() (with the same
+	allowNegativeWeights), cells (vertex numbers, x * size + y) with their new heights,
+	and a buffer for up to 8 * count changes
+	Returns number of edges whose weight changed, written to changes
+**************************************************************************/
+int patch_dem_cells(int** array2D, int size, CsrGraph *graph, int allowNegativeWeights,
+	const int *cells, const int *heights, int count, EdgeUpdate *changes) {
+
+	for (int i = 0; i < count; i++) {
+		array2D[cells[i] / size][cells[i] % size] = heights[i];
+	}
+
+	int changed = 0;
+	for (int i = 0; i < count; i++) {
+		int x = cells[i] / size;
+		int y = cells[i] % size;
+		int neighbours[4];
+		int n = 0;
+
+		if (y != size - 1) neighbours[n++] = cells[i] + 1;		// East
+		if (y != 0) neighbours[n++] = cells[i] - 1;				// West
+		if (x != size - 1) neighbours[n++] = cells[i] + size;	// South
+		if (x != 0) neighbours[n++] = cells[i] - size;			// North
+
+		for (int j = 0; j < 2 * n; j++) {					// Edges out of, then into, cell
+			int from = j < n ? cells[i] : neighbours[j - n];
+			int to = j < n ? neighbours[j] : cells[i];
+			int e = find_edge(graph, from, to);
+			int weight = move_cost(array2D[from / size][from % size], array2D[to / size][to % size], allowNegativeWeights);
+
+			if (e != -1 && graph->weight[e] != weight) {
+				changes[changed].from = from;
+				changes[changed].to = to;
+				changes[changed].weight = weight;
+				changes[changed].oldWeight = graph->weight[e];
+				graph->weight[e] = weight;
+				changed++;
+			}
+		}
+	}
+	if (changed > 0) {
+		csr_mark_changed(graph);
+	}
+	return changed;
+}
+
+/* Prepares to repair a shortest path tree
+	Takes graph, source, and distance/previous as filled by dijkstra_csr(graph, source, ...)
+	Returns tree referring to (not copying) graph, distance and previous
+*********************************************************************************************/
+ShortestPathTree new_shortest_path_tree(CsrGraph *graph, int source, int* distance, int* previous) {
+
+	ShortestPathTree tree;
+	int vertexCount = graph->V;
+
+	tree.graph = graph;
+	tree.source = source;
+	tree.distance = distance;
+	tree.previous = previous;
+	tree.inOffsets = calloc(vertexCount + 1, sizeof(int));
+	tree.inEdges = malloc(graph->E * sizeof(int));
+	tree.edgeSource = malloc(graph->E * sizeof(int));
+	tree.affected = calloc(vertexCount, 1);
+	tree.touched = malloc(vertexCount * sizeof(int));
+	tree.queue = new_heap(vertexCount, 4);
+
+	for (int u = 0; u < vertexCount; u++) {				// Index in-edges by target
+		for (int e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+			tree.edgeSource[e] = u;
+			tree.inOffsets[graph->to_vertex[e] + 1]++;
+		}
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		tree.inOffsets[v + 1] += tree.inOffsets[v];
+	}
+	int *fill = malloc(vertexCount * sizeof(int));
+	for (int v = 0; v < vertexCount; v++) {
+		fill[v] = tree.inOffsets[v];
+	}
+	for (int e = 0; e < graph->E; e++) {
+		tree.inEdges[fill[graph->to_vertex[e]]++] = e;
+	}
+	free(fill);
+
+	return tree;
+}
+
+/* Destroys tree's index, freeing its memory (graph, distance and previous are kept)
+*************************************************************************************/
+void destroy_shortest_path_tree(ShortestPathTree *self) {
+	free(self->inOffsets);
+	free(self->inEdges);
+	free(self->edgeSource);
+	free(self->affected);
+	free(self->touched);
+	destroy_heap(&self->queue);
+}
+
+/* Repairs distance/previous after edge weights have changed
+	Takes tree, and the changes already applied to its graph (by apply_edge_updates()
+	or patch_dem_cells())
+
+	1. Vertices below an edge which got heavier, in the tree, are visited in order of
+	   distance. One with another in-edge giving the same distance from a vertex not
+	   affected is re-parented; otherwise it is affected, and so are its children.
+	2. Affected vertices take the best distance over in-edges from unaffected ones,
+	   heads of edges which got lighter take the new distance if shorter, and
+	   Dijkstra's algorithm continues from all of them until nothing improves.
+	Returns number of vertices whose distance was recomputed
+*********************************************************************************************/
+int repair_shortest_path_tree(ShortestPathTree *self, EdgeUpdate *changes, int count) {
+
+	CsrGraph *graph = self->graph;
+	int *distance = self->distance;
+	int *previous = self->previous;
+	IndexedHeap *queue = &self->queue;
+	int affectedCount = 0;
+
+	// 1. Find vertices whose distance may increase
+	for (int i = 0; i < count; i++) {
+		int v = changes[i].to;
+		if (changes[i].weight > changes[i].oldWeight && previous[v] == changes[i].from) {
+			heap_push(queue, v, distance[v]);
+		}
+	}
+	while (!heap_is_empty(queue)) {
+		int v = heap_pop(queue);
+
+		int parent = -1;
+		for (int i = self->inOffsets[v]; i < self->inOffsets[v + 1]; i++) {
+			int e = self->inEdges[i];
+			int u = self->edgeSource[e];
+			// u's distance is final if it is strictly shorter (it was visited first)
+			if (!self->affected[u] && distance[u] < distance[v] && distance[u] != INT_MAX
+				&& distance[u] + graph->weight[e] == distance[v]) {
+				parent = u;
+				break;
+			}
+		}
+		if (parent != -1) {
+			previous[v] = parent;
+			continue;
+		}
+
+		self->affected[v] = 1;
+		self->touched[affectedCount++] = v;
+		for (int e = graph->offsets[v]; e < graph->offsets[v + 1]; e++) {
+			int child = graph->to_vertex[e];
+			if (previous[child] == v && !self->affected[child]) {
+				heap_push(queue, child, distance[child]);
+			}
+		}
+	}
+
+	// 2. Recompute affected vertices and propagate decreases
+	for (int i = 0; i < affectedCount; i++) {
+		int v = self->touched[i];
+		distance[v] = INT_MAX;
+		previous[v] = -1;
+	}
+	for (int i = 0; i < affectedCount; i++) {
+		int v = self->touched[i];
+		for (int j = self->inOffsets[v]; j < self->inOffsets[v + 1]; j++) {
+			int e = self->inEdges[j];
+			int u = self->edgeSource[e];
+			if (!self->affected[u] && distance[u] != INT_MAX && distance[u] + graph->weight[e] < distance[v]) {
+				distance[v] = distance[u] + graph->weight[e];
+				previous[v] = u;
+			}
+		}
+		if (distance[v] != INT_MAX) {
+			heap_push(queue, v, distance[v]);
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		int u = changes[i].from;
+		int v = changes[i].to;
+		if (changes[i].weight < changes[i].oldWeight && distance[u] != INT_MAX
+			&& distance[u] + changes[i].weight < distance[v]) {
+			distance[v] = distance[u] + changes[i].weight;
+			previous[v] = u;
+			heap_push(queue, v, distance[v]);
+		}
+	}
+
+	int recomputed = affectedCount;
+	while (!heap_is_empty(queue)) {
+		int u = heap_pop(queue);
+		recomputed += !self->affected[u];
+
+		for (int e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+			int v = graph->to_vertex[e];
+			int alt = distance[u] + graph->weight[e];
+			if (alt < distance[v]) {
+				distance[v] = alt;
+				previous[v] = u;
+				heap_push(queue, v, alt);
+			}
+		}
+	}
+
+	for (int i = 0; i < affectedCount; i++) {
+		self->affected[self->touched[i]] = 0;
+	}
+	return recomputed;
+}
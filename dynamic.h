@@ -0,0 +1,42 @@
+#pragma once
+#include "graph.h"
+#include "pqueue.h"
+
+/* Change to the weight of edge from->to.
+	oldWeight is filled in when the change is applied to a graph.
+**************************************************************************/
+typedef struct edgeUpdate {
+	int from;
+	int to;
+	int weight;			// New weight
+	int oldWeight;
+} EdgeUpdate;
+
+/* Shortest path tree from one source, kept valid as edge weights change
+	(dynamic single-source shortest paths, Ramalingam-Reps style).
+	distance/previous are the caller's arrays, as filled by dijkstra_csr(); a repair
+	only touches vertices whose distance or previous vertex changes, and their
+	out-edges. Weights must be non-negative.
+**************************************************************************/
+typedef struct shortestPathTree {
+	CsrGraph *graph;		// Not owned; weights are patched in place
+	int source;
+	int *distance;
+	int *previous;
+	int *inOffsets;			// In-edges of v are edge numbers inEdges[inOffsets[v]] .. inEdges[inOffsets[v+1] - 1]
+	int *inEdges;
+	int *edgeSource;		// edgeSource[e] = vertex edge e leaves
+	char *affected;			// Scratch, all 0 between repairs
+	int *touched;			// Scratch list of affected vertices
+	IndexedHeap queue;
+} ShortestPathTree;
+
+// Functions for changing edge weights
+int apply_edge_updates(CsrGraph *graph, EdgeUpdate *updates, int count);
+int patch_dem_cells(int** array2D, int size, CsrGraph *graph, int allowNegativeWeights,
+	const int *cells, const int *heights, int count, EdgeUpdate *changes);
+
+// Functions for building/destroying/repairing shortest path trees
+ShortestPathTree new_shortest_path_tree(CsrGraph *graph, int source, int* distance, int* previous);
+void destroy_shortest_path_tree(ShortestPathTree *self);
+int repair_shortest_path_tree(ShortestPathTree *self, EdgeUpdate *changes, int count);
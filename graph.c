@@ -1,7 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stddef.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "graph.h"
+#include "pqueue.h"
+#include "stats.h"
+
+static void dijkstra_linear(Graph *self, int source, int *distance, int *previous);
+static void dijkstra_heap(Graph *self, int source, int *distance, int *previous, int arity);
+static void dijkstra_csr_linear(CsrGraph *self, int source, int *distance, int *previous);
+static void dijkstra_csr_heap(CsrGraph *self, int source, int *distance, int *previous, int arity);
+static void dijkstra_csr_dial(CsrGraph *self, int source, int *distance, int *previous, int maxWeight);
+static void dijkstra_csr_radix(CsrGraph *self, int source, int *distance, int *previous);
+static void fw_relax_all(int** distance, int** next, int vertexCount);
+static void fw_tile(int *distance, int *next, size_t n, int iStart, int iEnd, int jStart, int jEnd, int kStart, int kEnd);
+static int fw_row(int *distRow, int *nextRow, const int *distK, int distIK, int nextIK, int jStart, int jEnd);
 
 /* Initialises a new, empty, graph with n vertices
 	Takes int
@@ -45,6 +64,7 @@ void add_edge(Graph *self, int source, int destination, int weight) {
 EdgeNodePtr new_node(int destination, int weight) {
 
 	EdgeNodePtr new_node = malloc(sizeof(*new_node));
+	STATS_ADD(bytesAllocated, sizeof(*new_node));
 	new_node->next = NULL;
 
 	// Adds edge
@@ -56,6 +76,133 @@ EdgeNodePtr new_node(int destination, int weight) {
 
 
 
+/* Initialises a new CSR graph with n vertices and room for edgeCount edges
+	Offsets are zeroed; caller fills offsets, to_vertex and weight arrays
+*********************************************/
+CsrGraph new_csr_graph(int n, int edgeCount) {
+
+	CsrGraph new_graph;
+
+	new_graph.V = n;
+	new_graph.E = edgeCount;
+	new_graph.offsets = calloc(n + 1, sizeof(int));
+	new_graph.to_vertex = malloc(edgeCount * sizeof(int));
+	new_graph.weight = malloc(edgeCount * sizeof(int));
+	csr_mark_changed(&new_graph);
+	STATS_ADD(bytesAllocated, (n + 1 + 2 * (long long)edgeCount) * sizeof(int));
+
+	return new_graph;
+}
+
+/* Gives graph a new version number, never used by any other graph in the process
+	Call after changing edges or weights in place, so results cached for the old
+	version (see treecache.h) are no longer used
+*********************************************/
+void csr_mark_changed(CsrGraph *self) {
+	static unsigned long long lastVersion = 0;
+#if defined(__GNUC__)
+	self->version = __atomic_add_fetch(&lastVersion, 1, __ATOMIC_RELAXED);
+#else
+	unsigned long long version;
+	#pragma omp atomic capture
+	version = ++lastVersion;
+	self->version = version;
+#endif
+}
+
+/* Converts an adjacency list graph to CSR form
+	Takes a graph; edges of each vertex keep their adjacency list order
+	Returns CSR graph (original graph is unchanged)
+*********************************************/
+CsrGraph csr_from_graph(Graph *self) {
+
+	int vertexCount = self->V;
+	int edgeCount = 0;
+
+	for (int i = 0; i < vertexCount; i++) {				// Count edges
+		for (EdgeNodePtr temp = self->edges[i].head; temp; temp = temp->next) {
+			edgeCount++;
+		}
+	}
+
+	CsrGraph csr = new_csr_graph(vertexCount, edgeCount);
+
+	int e = 0;
+	for (int i = 0; i < vertexCount; i++) {				// Copy edges in order
+		csr.offsets[i] = e;
+		for (EdgeNodePtr temp = self->edges[i].head; temp; temp = temp->next) {
+			csr.to_vertex[e] = temp->edge.to_vertex;
+			csr.weight[e] = temp->edge.weight;
+			e++;
+		}
+	}
+	csr.offsets[vertexCount] = e;
+
+	return csr;
+}
+
+/* Builds a CSR graph from an edge list
+	Takes number of vertices, number of edges, and three arrays of length edgeCount
+	where edge i goes from sources[i] to destinations[i] with weights[i]
+	Edges of each vertex keep the order they appear in the edge list
+*********************************************/
+CsrGraph csr_from_edges(int n, int edgeCount, int *sources, int *destinations, int *weights) {
+
+	CsrGraph csr = new_csr_graph(n, edgeCount);
+
+	for (int i = 0; i < edgeCount; i++) {				// Count edges leaving each vertex
+		csr.offsets[sources[i] + 1]++;
+	}
+	for (int v = 0; v < n; v++) {						// Prefix sum gives start of each row
+		csr.offsets[v + 1] += csr.offsets[v];
+	}
+
+	int *fill = malloc(n * sizeof(int));				// Next free slot in each row
+	for (int v = 0; v < n; v++) {
+		fill[v] = csr.offsets[v];
+	}
+	for (int i = 0; i < edgeCount; i++) {
+		int slot = fill[sources[i]]++;
+		csr.to_vertex[slot] = destinations[i];
+		csr.weight[slot] = weights[i];
+	}
+	free(fill);
+
+	return csr;
+}
+
+/* Builds the reverse (transposed) graph: every edge u->v becomes v->u with the same weight
+	Takes a CSR graph, returns new CSR graph
+	Used by searches which run backwards from a target
+*********************************************/
+CsrGraph csr_transpose(CsrGraph *self) {
+
+	int vertexCount = self->V;
+	CsrGraph reverse = new_csr_graph(vertexCount, self->E);
+
+	for (int e = 0; e < self->E; e++) {				// Count edges entering each vertex
+		reverse.offsets[self->to_vertex[e] + 1]++;
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		reverse.offsets[v + 1] += reverse.offsets[v];
+	}
+
+	int *fill = malloc(vertexCount * sizeof(int));
+	for (int v = 0; v < vertexCount; v++) {
+		fill[v] = reverse.offsets[v];
+	}
+	for (int u = 0; u < vertexCount; u++) {
+		for (int e = self->offsets[u]; e < self->offsets[u + 1]; e++) {
+			int slot = fill[self->to_vertex[e]]++;
+			reverse.to_vertex[slot] = u;
+			reverse.weight[slot] = self->weight[e];
+		}
+	}
+	free(fill);
+
+	return reverse;
+}
+
 /*	 Destroys graph, freeing all memory
 	 Takes a graph
 ******************************************/
@@ -66,6 +213,16 @@ void destroy_graph(Graph *self) {
 	}
 	free(self->edges);
 }
+/* Destroys CSR graph, freeing all memory
+******************************************/
+void destroy_csr_graph(CsrGraph *self) {
+	free(self->offsets);
+	free(self->to_vertex);
+	free(self->weight);
+	self->V = 0;
+	self->E = 0;
+}
+
 /* Helper function used when destroying graph
 **********************************************/
 void destroy_edgeNode(EdgeNodePtr node) {
@@ -95,6 +252,18 @@ void print_graph(Graph *self) {
 	}
 }
 
+/* Prints a CSR graph's edges for each vertex, in the same format as print_graph()
+**********************************************/
+void print_csr_graph(CsrGraph *self) {
+
+	for (int i = 0; i < self->V; ++i) {
+		printf("\n Adjacency list of vertex %d\n head ", i);
+		for (int e = self->offsets[i]; e < self->offsets[i + 1]; e++) {
+			printf("---%d-->%d  ", self->weight[e], self->to_vertex[e]);
+		}
+	}
+}
+
 
 
 /* Dijkstra's Shortest Path
@@ -105,11 +274,48 @@ void print_graph(Graph *self) {
 
 	Entries of resultant 'distance' array are shortest distance to vertex from source
 	Entries of resultant 'previous' array are vertex visited before arriving at vertex
+	Unreachable vertices are left with distance INT_MAX and previous -1
 *********************************************************************************************/
 void dijkstra(Graph *self, int source, int *distance, int *previous) {
+	dijkstra_with(self, source, distance, previous, DIJKSTRA_QUAD_HEAP);
+}
 
+/* Dijkstra's Shortest Path, with choice of priority queue
+	Takes a graph, source vertex, two arrays of length = vertex count, and engine
+	Results are identical to dijkstra() for every engine; vertices are settled
+	in the same order (nearest first, lowest vertex number on ties)
+*********************************************************************************************/
+void dijkstra_with(Graph *self, int source, int *distance, int *previous, DijkstraEngine engine) {
+
+	switch (engine) {
+	case DIJKSTRA_LINEAR:
+		dijkstra_linear(self, source, distance, previous);
+		break;
+	case DIJKSTRA_BINARY_HEAP:
+		dijkstra_heap(self, source, distance, previous, 2);
+		break;
+	case DIJKSTRA_DIAL:
+	case DIJKSTRA_RADIX_HEAP: {
+		CsrGraph csr = csr_from_graph(self);		// Bucket engines work on packed edges
+		dijkstra_csr_with(&csr, source, distance, previous, engine);
+		destroy_csr_graph(&csr);
+		break;
+	}
+	case DIJKSTRA_QUAD_HEAP:
+	default:
+		dijkstra_heap(self, source, distance, previous, 4);
+		break;
+	}
+}
+
+/* Original implementation; nearest vertex found by scanning all vertices
+*********************************************************************************************/
+static void dijkstra_linear(Graph *self, int source, int *distance, int *previous) {
+
+	STATS_TIMER_START(timer);
 	int vertexCount = self->V;
 	int *visited = malloc(vertexCount*(sizeof(int))); // This is array of vertices ('vertex set')
+	STATS_ADD(bytesAllocated, vertexCount * sizeof(int));
 
 	// Initialising arrays
 	for (int i = 0; i < vertexCount; i++) {
@@ -121,17 +327,23 @@ void dijkstra(Graph *self, int source, int *distance, int *previous) {
 
 	while (array_contains(visited, vertexCount, 0)) {			 // While vertices remain unvisited
 		int nearNode = array_minimum(distance, visited, vertexCount);	 // Find nearest unvisited vertex
+		if (nearNode == -1) {							// Remaining vertices are unreachable
+			break;
+		}
 		visited[nearNode] = 1;							// Set as visited
+		STATS_ADD(settled, 1);
 
 		EdgeNodePtr temp = self->edges[nearNode].head;		// For each neighbouring vertex
 		Edge *current = &temp->edge;
 
 		while (temp) {
+			STATS_ADD(relaxed, 1);
 			if (visited[current->to_vertex] == 0) {					// Check if vertex is not visited
 				int alt = current->weight + distance[nearNode];		// 
 				if (alt < distance[current->to_vertex]) {			// A shorter path to vertex has been found
 					distance[current->to_vertex] = alt;				// Update distance
 					previous[current->to_vertex] = nearNode;		// Remember how we get there
+					STATS_ADD(improved, 1);
 				}
 			}
 			temp = temp->next;			// Continue traversing adjacency list
@@ -140,6 +352,429 @@ void dijkstra(Graph *self, int source, int *distance, int *previous) {
 	}
 	// Visited array not needed, so free memory
 	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Heap implementation; unvisited vertices with a known distance are kept in an
+	indexed d-ary heap, and their keys decreased in place when a shorter path is found
+*********************************************************************************************/
+static void dijkstra_heap(Graph *self, int source, int *distance, int *previous, int arity) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	int *visited = malloc(vertexCount*(sizeof(int)));
+	STATS_ADD(bytesAllocated, vertexCount * sizeof(int));
+	IndexedHeap queue = new_heap(vertexCount, arity);
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	heap_push(&queue, source, 0);
+
+	while (!heap_is_empty(&queue)) {
+		int nearNode = heap_pop(&queue);				// Nearest unvisited vertex
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		for (EdgeNodePtr temp = self->edges[nearNode].head; temp; temp = temp->next) {
+			Edge *current = &temp->edge;
+			STATS_ADD(relaxed, 1);
+			if (visited[current->to_vertex] == 0) {
+				int alt = current->weight + distance[nearNode];
+				if (alt < distance[current->to_vertex]) {
+					distance[current->to_vertex] = alt;
+					previous[current->to_vertex] = nearNode;
+					STATS_ADD(improved, 1);
+					heap_push(&queue, current->to_vertex, alt);	// Insert or decrease-key
+				}
+			}
+		}
+	}
+
+	destroy_heap(&queue);
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Dijkstra's Shortest Path over a CSR graph
+	Same contract as dijkstra(); adjacency of each vertex is scanned sequentially
+*********************************************************************************************/
+void dijkstra_csr(CsrGraph *self, int source, int *distance, int *previous) {
+	dijkstra_csr_with(self, source, distance, previous, DIJKSTRA_QUAD_HEAP);
+}
+
+/* Dijkstra's Shortest Path over a CSR graph, with choice of priority queue
+*********************************************************************************************/
+void dijkstra_csr_with(CsrGraph *self, int source, int *distance, int *previous, DijkstraEngine engine) {
+
+	// Bucket engines need non-negative weights, and Dial's needs the largest weight
+	int maxWeight = 0;
+	if (engine == DIJKSTRA_DIAL || engine == DIJKSTRA_RADIX_HEAP) {
+		for (int e = 0; e < self->E; e++) {
+			if (self->weight[e] < 0) {
+				engine = DIJKSTRA_QUAD_HEAP;		// Not monotone; fall back to heap
+				break;
+			}
+			maxWeight = self->weight[e] > maxWeight ? self->weight[e] : maxWeight;
+		}
+	}
+
+	switch (engine) {
+	case DIJKSTRA_LINEAR:
+		dijkstra_csr_linear(self, source, distance, previous);
+		break;
+	case DIJKSTRA_DIAL:
+		dijkstra_csr_dial(self, source, distance, previous, maxWeight);
+		break;
+	case DIJKSTRA_RADIX_HEAP:
+		dijkstra_csr_radix(self, source, distance, previous);
+		break;
+	case DIJKSTRA_BINARY_HEAP:
+		dijkstra_csr_heap(self, source, distance, previous, 2);
+		break;
+	case DIJKSTRA_QUAD_HEAP:
+	default:
+		dijkstra_csr_heap(self, source, distance, previous, 4);
+		break;
+	}
+}
+
+static void dijkstra_csr_linear(CsrGraph *self, int source, int *distance, int *previous) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	int *visited = malloc(vertexCount*(sizeof(int)));
+	STATS_ADD(bytesAllocated, vertexCount * sizeof(int));
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+
+	while (array_contains(visited, vertexCount, 0)) {
+		int nearNode = array_minimum(distance, visited, vertexCount);
+		if (nearNode == -1) {
+			break;
+		}
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		for (int e = self->offsets[nearNode]; e < self->offsets[nearNode + 1]; e++) {
+			int to = self->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = self->weight[e] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					STATS_ADD(improved, 1);
+				}
+			}
+		}
+	}
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+static void dijkstra_csr_heap(CsrGraph *self, int source, int *distance, int *previous, int arity) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	int *visited = malloc(vertexCount*(sizeof(int)));
+	STATS_ADD(bytesAllocated, vertexCount * sizeof(int));
+	IndexedHeap queue = new_heap(vertexCount, arity);
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	heap_push(&queue, source, 0);
+
+	while (!heap_is_empty(&queue)) {
+		int nearNode = heap_pop(&queue);
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		for (int e = self->offsets[nearNode]; e < self->offsets[nearNode + 1]; e++) {
+			int to = self->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = self->weight[e] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					STATS_ADD(improved, 1);
+					heap_push(&queue, to, alt);
+				}
+			}
+		}
+	}
+
+	destroy_heap(&queue);
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Dial's algorithm; vertices are kept in a circular array of maxWeight + 1 buckets
+*********************************************************************************************/
+static void dijkstra_csr_dial(CsrGraph *self, int source, int *distance, int *previous, int maxWeight) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	char *visited = malloc(vertexCount);
+	STATS_ADD(bytesAllocated, vertexCount);
+	BucketQueue queue = new_bucket_queue(vertexCount, maxWeight);
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	bucket_push(&queue, source, 0);
+
+	while (!bucket_is_empty(&queue)) {
+		int nearNode = bucket_pop(&queue);
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		for (int e = self->offsets[nearNode]; e < self->offsets[nearNode + 1]; e++) {
+			int to = self->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = self->weight[e] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					STATS_ADD(improved, 1);
+					bucket_push(&queue, to, alt);
+				}
+			}
+		}
+	}
+
+	destroy_bucket_queue(&queue);
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Radix heap Dijkstra; stale queue entries (vertex already settled) are skipped
+*********************************************************************************************/
+static void dijkstra_csr_radix(CsrGraph *self, int source, int *distance, int *previous) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	char *visited = malloc(vertexCount);
+	STATS_ADD(bytesAllocated, vertexCount);
+	RadixHeap queue = new_radix_heap();
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	radix_push(&queue, source, 0);
+
+	while (!radix_is_empty(&queue)) {
+		unsigned key;
+		int nearNode = radix_pop(&queue, &key);
+		if (visited[nearNode]) {
+			continue;
+		}
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		for (int e = self->offsets[nearNode]; e < self->offsets[nearNode + 1]; e++) {
+			int to = self->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = self->weight[e] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					STATS_ADD(improved, 1);
+					radix_push(&queue, to, (unsigned)alt);
+				}
+			}
+		}
+	}
+
+	destroy_radix_heap(&queue);
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Point-to-point Dijkstra over a CSR graph
+	Takes a graph, source and target vertices, and two arrays of length = vertex count
+	Stops as soon as target is settled, and returns its distance (INT_MAX if unreachable)
+
+	Path to target can be traced through 'previous' as for dijkstra(); entries for
+	vertices that were not reached before the search stopped are INT_MAX / -1
+*********************************************************************************************/
+int dijkstra_csr_target(CsrGraph *self, int source, int target, int *distance, int *previous) {
+	return astar_csr(self, source, target, NULL, NULL, distance, previous);
+}
+
+/* A* search over a CSR graph
+	As dijkstra_csr_target(), but vertices are settled in order of
+	distance + h(vertex, context), so the search heads towards target.
+	h must be consistent (never decrease by more than an edge's weight along that edge)
+	for the returned distance to be shortest; NULL h gives plain Dijkstra.
+*********************************************************************************************/
+int astar_csr(CsrGraph *self, int source, int target, Heuristic h, void *context, int *distance, int *previous) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	char *visited = malloc(vertexCount);
+	STATS_ADD(bytesAllocated, vertexCount);
+	IndexedHeap queue = new_heap(vertexCount, 4);
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	heap_push(&queue, source, h ? h(source, context) : 0);
+
+	while (!heap_is_empty(&queue)) {
+		int nearNode = heap_pop(&queue);
+		visited[nearNode] = 1;
+		STATS_ADD(settled, 1);
+		if (nearNode == target) {				// Target settled; its distance is final
+			break;
+		}
+
+		for (int e = self->offsets[nearNode]; e < self->offsets[nearNode + 1]; e++) {
+			int to = self->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = self->weight[e] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					STATS_ADD(improved, 1);
+					heap_push(&queue, to, h ? alt + h(to, context) : alt);
+				}
+			}
+		}
+	}
+
+	destroy_heap(&queue);
+	free(visited);
+	STATS_TIMER_STOP(timer, searchSeconds);
+	return distance[target];
+}
+
+/* Bidirectional Dijkstra over a CSR graph
+	Takes a graph, its reverse (from csr_transpose()), source and target vertices,
+	and a 'previous' array of length = vertex count
+
+	Searches forwards from source and backwards from target, always expanding the side
+	with the smaller queue minimum, and stops once the two minimums together are no
+	less than the best source->target path seen through any edge joining the searches.
+	Edge weights must be non-negative.
+
+	Returns distance from source to target (INT_MAX if unreachable). On return the
+	'previous' chain from target leads back to source, as for dijkstra(); other entries
+	are unspecified.
+*********************************************************************************************/
+int bidirectional_dijkstra_csr(CsrGraph *self, CsrGraph *reverse, int source, int target, int *previous) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	int *distance[2];
+	int *parent[2];
+	char *visited[2];
+	CsrGraph *graph[2] = { self, reverse };
+	IndexedHeap queue[2];
+
+	int *nextHop = malloc(vertexCount * sizeof(int));		// parent[1]: next vertex towards target
+	parent[0] = previous;
+	parent[1] = nextHop;
+
+	for (int side = 0; side < 2; side++) {
+		distance[side] = malloc(vertexCount * sizeof(int));
+		visited[side] = malloc(vertexCount);
+		queue[side] = new_heap(vertexCount, 4);
+		for (int i = 0; i < vertexCount; i++) {
+			distance[side][i] = INT_MAX;
+			parent[side][i] = -1;
+			visited[side][i] = 0;
+		}
+	}
+	distance[0][source] = 0;
+	distance[1][target] = 0;
+	heap_push(&queue[0], source, 0);
+	heap_push(&queue[1], target, 0);
+
+	long long best = source == target ? 0 : LLONG_MAX;	// Shortest path found so far
+	int meetFrom = -1;		// Best path is source..meetFrom -> meetTo..target
+	int meetTo = -1;
+
+	while (!heap_is_empty(&queue[0]) && !heap_is_empty(&queue[1])) {
+
+		long long forwardMin = heap_min_key(&queue[0]);
+		long long backwardMin = heap_min_key(&queue[1]);
+		if (forwardMin + backwardMin >= best) {		// No shorter path can remain
+			break;
+		}
+
+		int side = forwardMin <= backwardMin ? 0 : 1;
+		int other = 1 - side;
+		int nearNode = heap_pop(&queue[side]);
+		visited[side][nearNode] = 1;
+		STATS_ADD(settled, 1);
+
+		CsrGraph *g = graph[side];
+		for (int e = g->offsets[nearNode]; e < g->offsets[nearNode + 1]; e++) {
+			int to = g->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			int alt = g->weight[e] + distance[side][nearNode];
+
+			if (visited[side][to] == 0 && alt < distance[side][to]) {
+				distance[side][to] = alt;
+				parent[side][to] = nearNode;
+				STATS_ADD(improved, 1);
+				heap_push(&queue[side], to, alt);
+			}
+			if (distance[other][to] != INT_MAX && (long long)alt + distance[other][to] < best) {
+				best = (long long)alt + distance[other][to];	// Searches meet on this edge
+				meetFrom = side == 0 ? nearNode : to;
+				meetTo = side == 0 ? to : nearNode;
+			}
+		}
+	}
+
+	// Forward parents already lead from meetFrom back to source; extend chain to target
+	if (meetFrom != -1) {
+		previous[meetTo] = meetFrom;
+		for (int v = meetTo; v != target; v = nextHop[v]) {
+			previous[nextHop[v]] = v;
+		}
+	}
+	if (source == target) {
+		previous[source] = -1;
+	}
+
+	for (int side = 0; side < 2; side++) {
+		free(distance[side]);
+		free(visited[side]);
+		destroy_heap(&queue[side]);
+	}
+	free(nextHop);
+	STATS_ADD(bytesAllocated, 3 * (long long)vertexCount * sizeof(int) + 2 * (long long)vertexCount);
+	STATS_TIMER_STOP(timer, searchSeconds);
+
+	return best == LLONG_MAX ? INT_MAX : (int)best;
 }
 
 /* Helper functions for Dijkstra implementation
@@ -161,11 +796,11 @@ int array_contains(int *array, int size, int value) {
 	Takes array of distances, and array of vertices where:
 		(contains[i] = 1 for visited, 0 if not visited)
 
-	Returns index of closest vertex that is unvisited
+	Returns index of closest vertex that is unvisited, or -1 if none is reachable
 ****************************************************************/
 int array_minimum(int *distance, int *contains, int size) {
 	int minimum = INT_MAX; // set as INF first
-	int index;
+	int index = -1;
 	for (int i = 0; i < size; i++) {
 		if (contains[i] == 0) {
 			if (distance[i] < minimum) {
@@ -207,6 +842,34 @@ void floyd_warshall(Graph *self, int** distance, int** next) {
 		}
 	}
 
+	fw_relax_all(distance, next, vertexCount);
+}
+
+/* Floyd-Warshall algorithm over a CSR graph
+	Same contract as floyd_warshall()
+********************************************************************/
+void floyd_warshall_csr(CsrGraph *self, int** distance, int** next) {
+
+	int vertexCount = self->V;
+
+	// populate distance array with weights
+	for (int i = 0; i < vertexCount; i++) {
+		for (int e = self->offsets[i]; e < self->offsets[i + 1]; e++) {
+			distance[i][self->to_vertex[e]] = self->weight[e];
+			next[i][self->to_vertex[e]] = self->to_vertex[e];
+		}
+	}
+
+	fw_relax_all(distance, next, vertexCount);
+}
+
+/* Helper function for Floyd-Warshall; relaxes every pair (i,j) through every vertex k
+	Takes distance/next tables already populated with edge weights
+********************************************************************/
+static void fw_relax_all(int** distance, int** next, int vertexCount) {
+
+	STATS_TIMER_START(timer);
+
 	// Loop through all pairs of vertices
 	for (int k = 0; k < vertexCount; k++) {
 		for (int i = 0; i < vertexCount; i++) {
@@ -216,9 +879,191 @@ void floyd_warshall(Graph *self, int** distance, int** next) {
 
 					distance[i][j] = distance[i][k] + distance[k][j];
 					next[i][j] = next[i][k]; // Next is 'remembered'
+					STATS_ADD(improved, 1);
 				}
 			}
 		}
 	}
+	STATS_ADD(relaxed, (long long)vertexCount * vertexCount * vertexCount);
+	STATS_TIMER_STOP(timer, searchSeconds);
 }
 
+
+/* Blocked Floyd-Warshall algorithm
+	Takes a CSR graph, two flat row-major |V|x|V| tables, tile width, and thread count
+	(blockSize <= 0 uses FW_BLOCK_SIZE; threads <= 0 uses every available core)
+
+	Tables must be initialised by the caller as for floyd_warshall(), and are indexed
+	distance[i * |V| + j]. Produces the same distances as floyd_warshall(); 'next'
+	gives an equally short path where several exist.
+
+	For each diagonal tile k the work is done in three dependent phases:
+		1. the diagonal tile (k,k) itself,
+		2. every tile in row k and column k, which only depend on (k,k),
+		3. every remaining tile (i,j), which only depends on (i,k) and (k,j).
+	Tiles within phases 2 and 3 are independent and are shared across threads.
+********************************************************************/
+void floyd_warshall_blocked(CsrGraph *self, int* distance, int* next, int blockSize, int threads) {
+
+	STATS_TIMER_START(timer);
+	int vertexCount = self->V;
+	size_t n = (size_t)vertexCount;
+
+	if (blockSize <= 0) {
+		blockSize = FW_BLOCK_SIZE;
+	}
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+
+	// populate distance array with weights
+	for (int i = 0; i < vertexCount; i++) {
+		for (int e = self->offsets[i]; e < self->offsets[i + 1]; e++) {
+			distance[i * n + self->to_vertex[e]] = self->weight[e];
+			next[i * n + self->to_vertex[e]] = self->to_vertex[e];
+		}
+	}
+
+	int blocks = (vertexCount + blockSize - 1) / blockSize;
+	STATS_PARENT(parent);
+
+	for (int kb = 0; kb < blocks; kb++) {
+		int kStart = kb * blockSize;
+		int kEnd = kStart + blockSize < vertexCount ? kStart + blockSize : vertexCount;
+
+		// Phase 1: diagonal tile
+		fw_tile(distance, next, n, kStart, kEnd, kStart, kEnd, kStart, kEnd);
+
+		// Phase 2: tiles sharing a row or column with the diagonal tile
+		#pragma omp parallel num_threads(threads)
+		{
+			STATS_WORKER_BEGIN(parent);
+			#pragma omp for schedule(dynamic)
+			for (int b = 0; b < 2 * blocks; b++) {
+				int other = b % blocks;
+				if (other == kb) {
+					continue;
+				}
+				int oStart = other * blockSize;
+				int oEnd = oStart + blockSize < vertexCount ? oStart + blockSize : vertexCount;
+				if (b < blocks) {		// Row k
+					fw_tile(distance, next, n, kStart, kEnd, oStart, oEnd, kStart, kEnd);
+				}
+				else {					// Column k
+					fw_tile(distance, next, n, oStart, oEnd, kStart, kEnd, kStart, kEnd);
+				}
+			}
+			STATS_WORKER_END(parent);
+		}
+
+		// Phase 3: all remaining tiles
+		#pragma omp parallel num_threads(threads)
+		{
+			STATS_WORKER_BEGIN(parent);
+			#pragma omp for schedule(dynamic)
+			for (int t = 0; t < blocks * blocks; t++) {
+				int ib = t / blocks;
+				int jb = t % blocks;
+				if (ib == kb || jb == kb) {
+					continue;
+				}
+				int iStart = ib * blockSize;
+				int iEnd = iStart + blockSize < vertexCount ? iStart + blockSize : vertexCount;
+				int jStart = jb * blockSize;
+				int jEnd = jStart + blockSize < vertexCount ? jStart + blockSize : vertexCount;
+				fw_tile(distance, next, n, iStart, iEnd, jStart, jEnd, kStart, kEnd);
+			}
+			STATS_WORKER_END(parent);
+		}
+	}
+	STATS_ADD(relaxed, (long long)vertexCount * vertexCount * vertexCount);
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Helper function for blocked Floyd-Warshall; relaxes tile rows [iStart, iEnd) and
+	columns [jStart, jEnd) through vertices [kStart, kEnd), in order of k
+********************************************************************/
+static void fw_tile(int *distance, int *next, size_t n, int iStart, int iEnd, int jStart, int jEnd, int kStart, int kEnd) {
+
+	long long improved = 0;
+	for (int k = kStart; k < kEnd; k++) {
+		const int *distK = distance + k * n;
+		for (int i = iStart; i < iEnd; i++) {
+			int distIK = distance[i * n + k];
+			if (distIK >= INT_MAX / 2) {		// No path i->k, nothing can improve
+				continue;
+			}
+			improved += fw_row(distance + i * n, next + i * n, distK, distIK, next[i * n + k], jStart, jEnd);
+		}
+	}
+	STATS_ADD(improved, improved);
+	(void)improved;
+}
+
+#if defined(DIJKSTRA_STATS) && (defined(__AVX2__) || defined(__SSE4_1__))
+/* Helper function which counts the set bits of a compare mask
+********************************************************************/
+static int count_bits(unsigned mask) {
+	int count = 0;
+	for (; mask != 0; mask &= mask - 1) {
+		count++;
+	}
+	return count;
+}
+#endif
+
+/* Innermost Floyd-Warshall kernel for one row:
+	for each j, if distRow[j] > distIK + distK[j], take the path via k.
+	Uses AVX2 or SSE4.1 min/compare/blend where the compiler targets them.
+	Returns number of columns improved (always 0 without DIJKSTRA_STATS)
+********************************************************************/
+static int fw_row(int *distRow, int *nextRow, const int *distK, int distIK, int nextIK, int jStart, int jEnd) {
+
+	int j = jStart;
+	int improved = 0;
+
+#if defined(__AVX2__)
+	__m256i vIK = _mm256_set1_epi32(distIK);
+	__m256i vNext = _mm256_set1_epi32(nextIK);
+	for (; j + 8 <= jEnd; j += 8) {
+		__m256i via = _mm256_add_epi32(vIK, _mm256_loadu_si256((const __m256i *)(distK + j)));
+		__m256i current = _mm256_loadu_si256((const __m256i *)(distRow + j));
+		__m256i shorter = _mm256_cmpgt_epi32(current, via);
+		_mm256_storeu_si256((__m256i *)(distRow + j), _mm256_min_epi32(current, via));
+		__m256i oldNext = _mm256_loadu_si256((const __m256i *)(nextRow + j));
+		_mm256_storeu_si256((__m256i *)(nextRow + j), _mm256_blendv_epi8(oldNext, vNext, shorter));
+#ifdef DIJKSTRA_STATS
+		improved += count_bits((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(shorter)));
+#endif
+	}
+#elif defined(__SSE4_1__)
+	__m128i vIK = _mm_set1_epi32(distIK);
+	__m128i vNext = _mm_set1_epi32(nextIK);
+	for (; j + 4 <= jEnd; j += 4) {
+		__m128i via = _mm_add_epi32(vIK, _mm_loadu_si128((const __m128i *)(distK + j)));
+		__m128i current = _mm_loadu_si128((const __m128i *)(distRow + j));
+		__m128i shorter = _mm_cmpgt_epi32(current, via);
+		_mm_storeu_si128((__m128i *)(distRow + j), _mm_min_epi32(current, via));
+		__m128i oldNext = _mm_loadu_si128((const __m128i *)(nextRow + j));
+		_mm_storeu_si128((__m128i *)(nextRow + j), _mm_blendv_epi8(oldNext, vNext, shorter));
+#ifdef DIJKSTRA_STATS
+		improved += count_bits((unsigned)_mm_movemask_ps(_mm_castsi128_ps(shorter)));
+#endif
+	}
+#endif
+
+	for (; j < jEnd; j++) {							// Remaining columns (or all, without SIMD)
+		int via = distIK + distK[j];
+		int shorter = distRow[j] > via;
+		distRow[j] = shorter ? via : distRow[j];
+		nextRow[j] = shorter ? nextIK : nextRow[j];
+#ifdef DIJKSTRA_STATS
+		improved += shorter;
+#endif
+	}
+	return improved;
+}
@@ -1,5 +1,22 @@
 #pragma once
 
+// Priority queues available to dijkstra_with()
+typedef enum dijkstraEngine {
+	DIJKSTRA_LINEAR,		// Linear scan for nearest vertex, O(V^2)
+	DIJKSTRA_BINARY_HEAP,	// Indexed binary heap with decrease-key, O((V+E) log V)
+	DIJKSTRA_QUAD_HEAP,		// Indexed 4-ary heap with decrease-key (default)
+	DIJKSTRA_DIAL,			// Dial's circular buckets, O(1) per operation (non-negative weights)
+	DIJKSTRA_RADIX_HEAP		// Radix heap, O(log C) amortised for largest weight C (non-negative weights)
+} DijkstraEngine;
+
+/* Lower bound on the distance from a vertex to the search target, used by astar_csr().
+	Must never overestimate; context is passed through unchanged.
+**************************************************************************/
+typedef int (*Heuristic)(int vertex, void *context);
+
+// Default tile width used by floyd_warshall_blocked()
+#define FW_BLOCK_SIZE 64
+
 typedef struct edge {
 	int to_vertex;
 	int weight;
@@ -19,22 +36,54 @@ typedef struct graph {
 	EdgeList *edges;
 } Graph;
 
+/* Compressed sparse row graph.
+	Edges leaving vertex v are stored contiguously at
+	to_vertex[offsets[v]] .. to_vertex[offsets[v+1] - 1], with matching weights.
+**************************************************************************/
+typedef struct csrGraph {
+	int V;
+	int E;
+	int *offsets;		// V + 1 entries
+	int *to_vertex;		// E entries
+	int *weight;		// E entries
+	unsigned long long version;	// Unique to this graph and its current weights
+} CsrGraph;
+
 // Functions for building graphs, adding edges
 Graph new_graph(int n);
 EdgeNodePtr new_node(int destination, int weight);
 void add_edge(Graph *self, int source, int destination, int weight);
 
+// Functions for building compressed (CSR) graphs
+CsrGraph new_csr_graph(int n, int edgeCount);
+CsrGraph csr_from_graph(Graph *self);
+CsrGraph csr_from_edges(int n, int edgeCount, int *sources, int *destinations, int *weights);
+CsrGraph csr_transpose(CsrGraph *self);
+void csr_mark_changed(CsrGraph *self);
+
 // Functions for destroying graphs/freeing memory
 void destroy_edgeNode(EdgeNodePtr node);
 void destroy_graph(Graph *self);
+void destroy_csr_graph(CsrGraph *self);
 
 // Shortest path algorithms
 void dijkstra(Graph *self, int source, int* distance, int* previous);
+void dijkstra_with(Graph *self, int source, int* distance, int* previous, DijkstraEngine engine);
 void floyd_warshall(Graph *self, int** distance, int** next);
+void dijkstra_csr(CsrGraph *self, int source, int* distance, int* previous);
+void dijkstra_csr_with(CsrGraph *self, int source, int* distance, int* previous, DijkstraEngine engine);
+void floyd_warshall_csr(CsrGraph *self, int** distance, int** next);
+void floyd_warshall_blocked(CsrGraph *self, int* distance, int* next, int blockSize, int threads);
+
+// Point-to-point queries; return distance to target (INT_MAX if unreachable)
+int dijkstra_csr_target(CsrGraph *self, int source, int target, int* distance, int* previous);
+int astar_csr(CsrGraph *self, int source, int target, Heuristic h, void *context, int* distance, int* previous);
+int bidirectional_dijkstra_csr(CsrGraph *self, CsrGraph *reverse, int source, int target, int* previous);
 
 // Utility/helper functions; prints adjacency lists for each node
 void print_graph(Graph *self);
+void print_csr_graph(CsrGraph *self);
 
 // Functions used within Dijkstra algorithm
 int array_contains(int *array, int size, int value);
-int array_minimum(int *distance, int *contains, int size);
\ No newline at end of file
+int array_minimum(int *distance, int *contains, int size);
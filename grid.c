@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "grid.h"
+#include "pqueue.h"
+
+static int grid_search(GridGraph *self, int source, int target, GridHeuristic *h, int *distance, int *previous);
+
+/* Initialises a grid graph over an existing DEM (as produced by make_dem())
+	Takes DEM, size, and cost function
+	DEM is not copied, and must outlive the grid graph
+*********************************************/
+GridGraph grid_from_dem(int **dem, int size, CostFunction cost) {
+
+	GridGraph grid;
+
+	grid.rows = size;
+	grid.cols = size;
+	grid.V = size * size;
+	grid.height = dem;
+	grid.ownsRows = 0;
+	grid.costTable = NULL;
+
+	grid_set_cost(&grid, cost);
+
+	return grid;
+}
+
+/* Initialises a grid graph over a flat, row-major height array
+	Takes heights (rows * cols entries), number of rows and columns, and cost function
+	Heights are not copied, and must outlive the grid graph
+*********************************************/
+GridGraph new_grid_graph(int *heights, int rows, int cols, CostFunction cost) {
+
+	GridGraph grid;
+
+	grid.rows = rows;
+	grid.cols = cols;
+	grid.V = rows * cols;
+	grid.height = malloc(rows * sizeof *grid.height);	// Row pointers only
+	grid.ownsRows = 1;
+	grid.costTable = NULL;
+
+	for (int x = 0; x < rows; x++) {
+		grid.height[x] = heights + (size_t)x * cols;
+	}
+
+	grid_set_cost(&grid, cost);
+
+	return grid;
+}
+
+/* Replaces the grid's cost model
+	Tabulates cost(diff) for every difference between the lowest and highest
+	cell, so relaxation is a single table lookup with no branching on cost model
+*********************************************/
+void grid_set_cost(GridGraph *self, CostFunction cost) {
+
+	int low = INT_MAX;
+	int high = INT_MIN;
+
+	for (int x = 0; x < self->rows; x++) {
+		for (int y = 0; y < self->cols; y++) {
+			int h = self->height[x][y];
+			low = h < low ? h : low;
+			high = h > high ? h : high;
+		}
+	}
+	if (low > high) {			// Empty grid
+		low = high = 0;
+	}
+
+	free(self->costTable);
+	self->minDiff = low - high;
+	int entries = 2 * (high - low) + 1;
+	self->costTable = malloc(entries * sizeof(int));
+
+	for (int i = 0; i < entries; i++) {
+		self->costTable[i] = cost(self->minDiff + i);
+	}
+}
+
+/* Destroys grid graph; the heights themselves belong to the caller
+******************************************/
+void destroy_grid_graph(GridGraph *self) {
+	if (self->ownsRows) {
+		free(self->height);
+	}
+	free(self->costTable);
+	self->height = NULL;
+	self->costTable = NULL;
+}
+
+/* Returns weight of edge between two neighbouring vertices
+*************************************************************/
+int grid_weight(GridGraph *self, int from, int to) {
+	int diff = self->height[to / self->cols][to % self->cols]
+		- self->height[from / self->cols][from % self->cols];
+	return self->costTable[diff - self->minDiff];
+}
+
+/* Builds a Manhattan heuristic towards target for a grid graph
+	Lower bound per move is the cheapest entry in the grid's cost table
+*********************************************/
+GridHeuristic grid_heuristic(GridGraph *self, int target) {
+
+	GridHeuristic h;
+	int entries = -2 * self->minDiff + 1;
+
+	h.cols = self->cols;
+	h.target = target;
+	h.minCost = INT_MAX;
+	for (int i = 0; i < entries; i++) {
+		h.minCost = self->costTable[i] < h.minCost ? self->costTable[i] : h.minCost;
+	}
+	return h;
+}
+
+/* Heuristic function; context is a GridHeuristic
+	Returns minCost * Manhattan distance from vertex to target, or 0 if minCost <= 0
+*********************************************/
+int grid_manhattan(int vertex, void *context) {
+
+	GridHeuristic *h = context;
+	if (h->minCost <= 0) {
+		return 0;
+	}
+	int dx = vertex / h->cols - h->target / h->cols;
+	int dy = vertex % h->cols - h->target % h->cols;
+	return h->minCost * ((dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy));
+}
+
+/* Dijkstra's Shortest Path over a grid graph
+	Same contract as dijkstra(): fills 'distance' and 'previous' (length = rows * cols)
+	Neighbours and weights are computed as each vertex is settled, so no graph is allocated
+*********************************************************************************************/
+void grid_dijkstra(GridGraph *self, int source, int *distance, int *previous) {
+	grid_search(self, source, -1, NULL, distance, previous);
+}
+
+/* Point-to-point Dijkstra over a grid graph; stops once target is settled
+	Returns distance to target (INT_MAX if unreachable)
+*********************************************************************************************/
+int grid_dijkstra_target(GridGraph *self, int source, int target, int *distance, int *previous) {
+	return grid_search(self, source, target, NULL, distance, previous);
+}
+
+/* A* over a grid graph, guided by grid_heuristic(); stops once target is settled
+	Returns distance to target (INT_MAX if unreachable). With a cost model whose
+	cheapest move is <= 0 (e.g. cost_funcB) this is the same as grid_dijkstra_target()
+*********************************************************************************************/
+int grid_astar(GridGraph *self, int source, int target, int *distance, int *previous) {
+	GridHeuristic h = grid_heuristic(self, target);
+	return grid_search(self, source, target, &h, distance, previous);
+}
+
+/* Search shared by the grid functions above
+	target = -1 settles every reachable vertex; h = NULL disables the heuristic
+	Returns distance to target, or 0 when target = -1
+*********************************************************************************************/
+static int grid_search(GridGraph *self, int source, int target, GridHeuristic *h, int *distance, int *previous) {
+
+	int vertexCount = self->V;
+	int rows = self->rows;
+	int cols = self->cols;
+	int *costs = self->costTable - self->minDiff;		// costs[diff] = cost(diff)
+	char *visited = malloc(vertexCount);
+	IndexedHeap queue = new_heap(vertexCount, 4);
+
+	for (int i = 0; i < vertexCount; i++) {
+		visited[i] = 0;
+		distance[i] = INT_MAX;
+		previous[i] = -1;
+	}
+	distance[source] = 0;
+	heap_push(&queue, source, h ? grid_manhattan(source, h) : 0);
+
+	while (!heap_is_empty(&queue)) {
+		int nearNode = heap_pop(&queue);
+		visited[nearNode] = 1;
+		if (nearNode == target) {
+			break;
+		}
+
+		int x = nearNode / cols;
+		int y = nearNode % cols;
+		int sourceValue = self->height[x][y];
+
+		// Neighbours in build_graph() adjacency order: East, West, South, North
+		int neighbour[4];
+		int heights[4];
+		int count = 0;
+		if (y != cols - 1) {
+			neighbour[count] = nearNode + 1;
+			heights[count++] = self->height[x][y + 1];
+		}
+		if (y != 0) {
+			neighbour[count] = nearNode - 1;
+			heights[count++] = self->height[x][y - 1];
+		}
+		if (x != rows - 1) {
+			neighbour[count] = nearNode + cols;
+			heights[count++] = self->height[x + 1][y];
+		}
+		if (x != 0) {
+			neighbour[count] = nearNode - cols;
+			heights[count++] = self->height[x - 1][y];
+		}
+
+		for (int i = 0; i < count; i++) {
+			int to = neighbour[i];
+			if (visited[to] == 0) {
+				int alt = costs[heights[i] - sourceValue] + distance[nearNode];
+				if (alt < distance[to]) {
+					distance[to] = alt;
+					previous[to] = nearNode;
+					heap_push(&queue, to, h ? alt + grid_manhattan(to, h) : alt);
+				}
+			}
+		}
+	}
+
+	destroy_heap(&queue);
+	free(visited);
+	return target == -1 ? 0 : distance[target];
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Cost of moving between two cells, given (destination height - source height)
+typedef int (*CostFunction)(int diff);
+
+/* Implicit 4-connected grid graph over a height map.
+	No edges are stored: neighbours of cell (x, y) are the cells North, South,
+	West and East of it, and edge weights are looked up from a table of
+	cost(diff) built once for every height difference present in the map.
+
+	Vertex numbering matches build_graph(): vertex = x * cols + y
+**************************************************************************/
+typedef struct gridGraph {
+	int rows;
+	int cols;
+	int V;
+	int **height;		// height[x][y]; row pointers into caller's DEM
+	int ownsRows;		// 1 if 'height' was allocated by new_grid_graph()
+	int minDiff;		// Smallest height difference in costTable
+	int *costTable;		// costTable[diff - minDiff] = cost(diff)
+} GridGraph;
+
+/* Manhattan distance heuristic for grid searches (usable as a Heuristic in graph.h)
+	Every move changes Manhattan distance by exactly one and costs at least minCost,
+	so minCost * (|dx| + |dy|) never overestimates. minCost <= 0 gives no guidance.
+**************************************************************************/
+typedef struct gridHeuristic {
+	int cols;
+	int target;
+	int minCost;		// Lower bound on the cost of a single move
+} GridHeuristic;
+
+// Functions for building/destroying grid graphs
+GridGraph grid_from_dem(int **dem, int size, CostFunction cost);
+GridGraph new_grid_graph(int *heights, int rows, int cols, CostFunction cost);
+void grid_set_cost(GridGraph *self, CostFunction cost);
+void destroy_grid_graph(GridGraph *self);
+
+// Edge weight from vertex 'from' to neighbouring vertex 'to'
+int grid_weight(GridGraph *self, int from, int to);
+
+// Heuristics
+GridHeuristic grid_heuristic(GridGraph *self, int target);
+int grid_manhattan(int vertex, void *context);
+
+// Shortest path algorithms
+void grid_dijkstra(GridGraph *self, int source, int* distance, int* previous);
+int grid_dijkstra_target(GridGraph *self, int source, int target, int* distance, int* previous);
+int grid_astar(GridGraph *self, int source, int target, int* distance, int* previous);
@@ -0,0 +1,444 @@
+#include <stdlib.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "hpa.h"
+#include "stats.h"
+
+/* Tile geometry helpers
+**************************/
+static int tile_of(HpaPlanner *self, int vertex) {
+	int cols = self->grid->cols;
+	return (vertex / cols / self->tileSize) * self->tileCols + (vertex % cols) / self->tileSize;
+}
+
+static void tile_bounds(HpaPlanner *self, int tile, int *x0, int *y0, int *height, int *width) {
+	*x0 = (tile / self->tileCols) * self->tileSize;
+	*y0 = (tile % self->tileCols) * self->tileSize;
+	*height = self->grid->rows - *x0 < self->tileSize ? self->grid->rows - *x0 : self->tileSize;
+	*width = self->grid->cols - *y0 < self->tileSize ? self->grid->cols - *y0 : self->tileSize;
+}
+
+static TileScratch new_tile_scratch(int tileSize) {
+	TileScratch scratch;
+	scratch.queue = new_heap(tileSize * tileSize, 4);
+	scratch.distance = malloc(tileSize * tileSize * sizeof(int));
+	scratch.previous = malloc(tileSize * tileSize * sizeof(int));
+	return scratch;
+}
+
+static void destroy_tile_scratch(TileScratch *scratch) {
+	destroy_heap(&scratch->queue);
+	free(scratch->distance);
+	free(scratch->previous);
+}
+
+/* Dijkstra's algorithm confined to one tile
+	Takes planner, scratch, tile, source (grid vertex), target (grid vertex, or -1 for
+	the whole tile), and reverse: if set, distances are costs *to* source instead
+	Results are left in scratch, by local index
+	Returns distance to target (INT_MAX if not reached; 0 if target = -1)
+**************************************************************************/
+static int tile_search(HpaPlanner *self, TileScratch *scratch, int tile, int source, int target, int reverse) {
+
+	GridGraph *grid = self->grid;
+	int x0, y0, height, width;
+	tile_bounds(self, tile, &x0, &y0, &height, &width);
+
+	int cells = height * width;
+	for (int i = 0; i < cells; i++) {
+		scratch->distance[i] = INT_MAX;
+		scratch->previous[i] = -1;
+	}
+	heap_clear(&scratch->queue);
+
+	int start = (source / grid->cols - x0) * width + (source % grid->cols - y0);
+	int goal = target == -1 ? -1 : (target / grid->cols - x0) * width + (target % grid->cols - y0);
+	scratch->distance[start] = 0;
+	heap_push(&scratch->queue, start, 0);
+
+	while (!heap_is_empty(&scratch->queue)) {
+		int local = heap_pop(&scratch->queue);
+		if (local == goal) {
+			break;
+		}
+		int lx = local / width;
+		int ly = local % width;
+		int vertex = (x0 + lx) * grid->cols + y0 + ly;
+
+		int neighbours[4];
+		int n = 0;
+		if (ly != width - 1) neighbours[n++] = local + 1;		// East
+		if (ly != 0) neighbours[n++] = local - 1;				// West
+		if (lx != height - 1) neighbours[n++] = local + width;	// South
+		if (lx != 0) neighbours[n++] = local - width;			// North
+
+		for (int i = 0; i < n; i++) {
+			int next = neighbours[i];
+			int nextVertex = (x0 + next / width) * grid->cols + y0 + next % width;
+			int weight = reverse ? grid_weight(grid, nextVertex, vertex) : grid_weight(grid, vertex, nextVertex);
+			int alt = scratch->distance[local] + weight;
+			if (alt < scratch->distance[next]) {
+				scratch->distance[next] = alt;
+				scratch->previous[next] = local;
+				heap_push(&scratch->queue, next, alt);
+			}
+		}
+	}
+
+	return goal == -1 ? 0 : scratch->distance[goal];
+}
+
+/* Distance to/from grid vertex after tile_search() on the tile containing it
+******************************************************************************/
+static int tile_distance(HpaPlanner *self, TileScratch *scratch, int tile, int vertex) {
+	int x0, y0, height, width;
+	tile_bounds(self, tile, &x0, &y0, &height, &width);
+	return scratch->distance[(vertex / self->grid->cols - x0) * width + (vertex % self->grid->cols - y0)];
+}
+
+/* Helper function which adds a portal pair (a, b) of facing cells, numbering cells
+	not already portals
+**************************************************************************/
+static void add_portal_pair(HpaPlanner *self, int *cellPortal, int *crossings, int *crossingCount, int a, int b) {
+	int cells[2] = { a, b };
+	for (int i = 0; i < 2; i++) {
+		if (cellPortal[cells[i]] == -1) {
+			cellPortal[cells[i]] = self->portalCount;
+			self->portalCell[self->portalCount++] = cells[i];
+		}
+	}
+	crossings[2 * *crossingCount] = a;
+	crossings[2 * *crossingCount + 1] = b;
+	(*crossingCount)++;
+}
+
+/* Helper function giving the next portal position along a border of 'length' cells:
+	every 'step' cells, always ending on the last cell (returns length when done)
+**************************************************************************/
+static int border_next(int i, int length, int step) {
+	if (i == length - 1) {
+		return length;
+	}
+	return i + step < length ? i + step : length - 1;
+}
+
+/* Builds a planner over grid
+	Takes grid (which must outlive the planner), tile size, spacing of portals along
+	tile borders (<= 0 for tileSize / 4), and threads used to search tiles
+	(<= 0 for all cores)
+	Intra-tile portal distances are computed here, with one search per portal.
+*********************************************************************************************/
+HpaPlanner new_hpa_planner(GridGraph *grid, int tileSize, int portalStep, int threads) {
+
+	HpaPlanner planner;
+	HpaPlanner *self = &planner;
+
+	if (tileSize < 2) {
+		tileSize = 2;
+	}
+	if (portalStep <= 0) {
+		portalStep = tileSize / 4 > 0 ? tileSize / 4 : 1;
+	}
+	self->grid = grid;
+	self->tileSize = tileSize;
+	self->tileRows = (grid->rows + tileSize - 1) / tileSize;
+	self->tileCols = (grid->cols + tileSize - 1) / tileSize;
+	int tileCount = self->tileRows * self->tileCols;
+
+	// Portals along every border between neighbouring tiles
+	int borders = (self->tileRows - 1) * grid->cols + (self->tileCols - 1) * grid->rows;
+	int *cellPortal = malloc(grid->V * sizeof(int));
+	int *crossings = malloc(2 * borders * sizeof(int));
+	int crossingCount = 0;
+	for (int v = 0; v < grid->V; v++) {
+		cellPortal[v] = -1;
+	}
+	self->portalCount = 0;
+	self->portalCell = malloc(2 * borders * sizeof(int));
+
+	for (int tile = 0; tile < tileCount; tile++) {
+		int x0, y0, height, width;
+		tile_bounds(self, tile, &x0, &y0, &height, &width);
+
+		if (y0 + width < grid->cols) {				// Border with tile to the East
+			for (int i = 0; i < height; i = border_next(i, height, portalStep)) {
+				int a = (x0 + i) * grid->cols + y0 + width - 1;
+				add_portal_pair(self, cellPortal, crossings, &crossingCount, a, a + 1);
+			}
+		}
+		if (x0 + height < grid->rows) {				// Border with tile to the South
+			for (int i = 0; i < width; i = border_next(i, width, portalStep)) {
+				int a = (x0 + height - 1) * grid->cols + y0 + i;
+				add_portal_pair(self, cellPortal, crossings, &crossingCount, a, a + grid->cols);
+			}
+		}
+	}
+	free(cellPortal);
+
+	// Portals grouped by tile
+	self->tileOffsets = calloc(tileCount + 1, sizeof(int));
+	self->tilePortals = malloc(self->portalCount * sizeof(int));
+	for (int p = 0; p < self->portalCount; p++) {
+		self->tileOffsets[tile_of(self, self->portalCell[p]) + 1]++;
+	}
+	for (int t = 0; t < tileCount; t++) {
+		self->tileOffsets[t + 1] += self->tileOffsets[t];
+	}
+	int *fill = malloc(tileCount * sizeof(int));
+	for (int t = 0; t < tileCount; t++) {
+		fill[t] = self->tileOffsets[t];
+	}
+	for (int p = 0; p < self->portalCount; p++) {
+		self->tilePortals[fill[tile_of(self, self->portalCell[p])]++] = p;
+	}
+	free(fill);
+
+	// Abstract edges: every ordered pair of portals within a tile, then crossings
+	int *edgeOffsets = malloc((tileCount + 1) * sizeof(int));
+	edgeOffsets[0] = 0;
+	for (int t = 0; t < tileCount; t++) {
+		int n = self->tileOffsets[t + 1] - self->tileOffsets[t];
+		edgeOffsets[t + 1] = edgeOffsets[t] + n * (n - 1);
+	}
+	int edgeCount = edgeOffsets[tileCount] + 2 * crossingCount;
+	int *sources = malloc(edgeCount * sizeof(int));
+	int *destinations = malloc(edgeCount * sizeof(int));
+	int *weights = malloc(edgeCount * sizeof(int));
+
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+
+	STATS_PARENT(parent);
+	#pragma omp parallel num_threads(threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+		TileScratch scratch = new_tile_scratch(tileSize);
+
+		#pragma omp for schedule(dynamic, 4)
+		for (int t = 0; t < tileCount; t++) {
+			int e = edgeOffsets[t];
+			for (int i = self->tileOffsets[t]; i < self->tileOffsets[t + 1]; i++) {
+				int from = self->tilePortals[i];
+				tile_search(self, &scratch, t, self->portalCell[from], -1, 0);
+				for (int j = self->tileOffsets[t]; j < self->tileOffsets[t + 1]; j++) {
+					int to = self->tilePortals[j];
+					if (to != from) {
+						sources[e] = from;
+						destinations[e] = to;
+						weights[e++] = tile_distance(self, &scratch, t, self->portalCell[to]);
+					}
+				}
+			}
+		}
+
+		destroy_tile_scratch(&scratch);
+		STATS_WORKER_END(parent);
+	}
+
+	int *portalOf = malloc(grid->V * sizeof(int));		// Crossings refer to cells
+	for (int p = 0; p < self->portalCount; p++) {
+		portalOf[self->portalCell[p]] = p;
+	}
+	for (int c = 0, e = edgeOffsets[tileCount]; c < crossingCount; c++) {
+		int a = crossings[2 * c];
+		int b = crossings[2 * c + 1];
+		sources[e] = portalOf[a];
+		destinations[e] = portalOf[b];
+		weights[e++] = grid_weight(grid, a, b);
+		sources[e] = portalOf[b];
+		destinations[e] = portalOf[a];
+		weights[e++] = grid_weight(grid, b, a);
+	}
+	free(portalOf);
+
+	self->abstract = csr_from_edges(self->portalCount, edgeCount, sources, destinations, weights);
+	free(sources);
+	free(destinations);
+	free(weights);
+	free(edgeOffsets);
+	free(crossings);
+
+	self->scratch = new_tile_scratch(tileSize);
+	self->queue = new_heap(self->portalCount, 4);
+	self->distance = malloc(self->portalCount * sizeof(int));
+	self->previous = malloc(self->portalCount * sizeof(int));
+	self->targetCost = malloc(self->portalCount * sizeof(int));
+	for (int p = 0; p < self->portalCount; p++) {
+		self->targetCost[p] = INT_MAX;
+	}
+
+	return planner;
+}
+
+/* Destroys planner, freeing all memory (the grid is kept)
+***********************************************************/
+void destroy_hpa_planner(HpaPlanner *self) {
+	free(self->portalCell);
+	free(self->tileOffsets);
+	free(self->tilePortals);
+	destroy_csr_graph(&self->abstract);
+	destroy_tile_scratch(&self->scratch);
+	destroy_heap(&self->queue);
+	free(self->distance);
+	free(self->previous);
+	free(self->targetCost);
+	self->portalCount = 0;
+}
+
+/* Helper function which appends the cells after 'from' on the shortest path to 'to'
+	(both in one tile) to path, or only counts them once path is full
+	Returns new path length
+**************************************************************************/
+static int refine_segment(HpaPlanner *self, int from, int to, int *path, int capacity, int length) {
+
+	int tile = tile_of(self, from);
+	if (tile != tile_of(self, to)) {						// A single move across a border
+		if (length < capacity) {
+			path[length] = to;
+		}
+		return length + 1;
+	}
+
+	// Search backwards from 'to', so previous[] leads from 'from' towards 'to'
+	int x0, y0, height, width;
+	tile_bounds(self, tile, &x0, &y0, &height, &width);
+	tile_search(self, &self->scratch, tile, to, from, 1);
+
+	int cols = self->grid->cols;
+	int local = (from / cols - x0) * width + (from % cols - y0);
+	while (self->scratch.previous[local] != -1) {
+		local = self->scratch.previous[local];
+		if (length < capacity) {
+			path[length] = (x0 + local / width) * cols + y0 + local % width;
+		}
+		length++;
+	}
+	return length;
+}
+
+/* Plans a route from source to target
+	Takes planner, source and target (grid vertices), and optional path buffer
+	(capacity entries; may be NULL)
+
+	Costs from source to the portals of its tile, and from the portals of target's
+	tile to target, are found by searches of those two tiles. Dijkstra's algorithm
+	then runs on the abstract graph until no portal can give a cheaper route; if
+	source and target share a tile the route inside it is also considered. The
+	chosen route is refined tile by tile into cells.
+	Returns cost (INT_MAX if unreachable). *pathLength receives the number of
+	vertices written to path, or 0 if path is NULL or too small.
+*********************************************************************************************/
+int hpa_route(HpaPlanner *self, int source, int target, int* path, int capacity, int* pathLength) {
+
+	int sourceTile = tile_of(self, source);
+	int targetTile = tile_of(self, target);
+	IndexedHeap *queue = &self->queue;
+
+	// Portals of target's tile: cost to target
+	tile_search(self, &self->scratch, targetTile, target, -1, 1);
+	for (int i = self->tileOffsets[targetTile]; i < self->tileOffsets[targetTile + 1]; i++) {
+		int p = self->tilePortals[i];
+		self->targetCost[p] = tile_distance(self, &self->scratch, targetTile, self->portalCell[p]);
+	}
+
+	// Portals of source's tile: cost from source
+	long long best = LLONG_MAX;
+	int bestPortal = -1;
+	tile_search(self, &self->scratch, sourceTile, source, -1, 0);
+	if (sourceTile == targetTile) {
+		best = tile_distance(self, &self->scratch, sourceTile, target);
+	}
+	for (int p = 0; p < self->portalCount; p++) {
+		self->distance[p] = INT_MAX;
+	}
+	heap_clear(queue);
+	for (int i = self->tileOffsets[sourceTile]; i < self->tileOffsets[sourceTile + 1]; i++) {
+		int p = self->tilePortals[i];
+		self->distance[p] = tile_distance(self, &self->scratch, sourceTile, self->portalCell[p]);
+		self->previous[p] = -1;
+		heap_push(queue, p, self->distance[p]);
+	}
+
+	while (!heap_is_empty(queue) && heap_min_key(queue) < best) {
+		int p = heap_pop(queue);
+		if (self->targetCost[p] != INT_MAX && (long long)self->distance[p] + self->targetCost[p] < best) {
+			best = (long long)self->distance[p] + self->targetCost[p];
+			bestPortal = p;
+		}
+		CsrGraph *g = &self->abstract;
+		for (int e = g->offsets[p]; e < g->offsets[p + 1]; e++) {
+			int q = g->to_vertex[e];
+			int alt = self->distance[p] + g->weight[e];
+			if (alt < self->distance[q]) {
+				self->distance[q] = alt;
+				self->previous[q] = p;
+				heap_push(queue, q, alt);
+			}
+		}
+	}
+
+	for (int i = self->tileOffsets[targetTile]; i < self->tileOffsets[targetTile + 1]; i++) {
+		self->targetCost[self->tilePortals[i]] = INT_MAX;
+	}
+
+	if (pathLength != NULL) {
+		*pathLength = 0;
+	}
+	if (best == LLONG_MAX) {
+		return INT_MAX;
+	}
+
+	if (path != NULL && pathLength != NULL) {
+		int hops = 0;									// Portals on route
+		for (int p = bestPortal; p != -1; p = self->previous[p]) {
+			hops++;
+		}
+		int *route = malloc((hops + 2) * sizeof(int));
+		route[0] = source;
+		int i = hops;
+		for (int p = bestPortal; p != -1; p = self->previous[p]) {
+			route[i--] = self->portalCell[p];
+		}
+		route[hops + 1] = target;
+
+		int length = 1;
+		if (capacity > 0) {
+			path[0] = source;
+		}
+		for (int k = 0; k <= hops; k++) {
+			if (route[k] != route[k + 1]) {
+				length = refine_segment(self, route[k], route[k + 1], path, capacity, length);
+			}
+		}
+		*pathLength = length <= capacity ? length : 0;
+		free(route);
+	}
+
+	return (int)best;
+}
+
+/* Compares a planned route with the exact shortest path
+	Returns (planned cost - exact cost) / exact cost, e.g. 0.02 = 2% longer,
+	or 0 if target is source or unreachable
+*********************************************************************************************/
+double hpa_optimality_gap(HpaPlanner *self, int source, int target) {
+
+	int *distance = malloc(self->grid->V * sizeof(int));
+	int *previous = malloc(self->grid->V * sizeof(int));
+	int exact = grid_dijkstra_target(self->grid, source, target, distance, previous);
+	free(distance);
+	free(previous);
+
+	int planned = hpa_route(self, source, target, NULL, 0, NULL);
+	if (exact == INT_MAX || exact <= 0 || planned == INT_MAX) {
+		return 0.0;
+	}
+	return (double)(planned - exact) / exact;
+}
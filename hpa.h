@@ -0,0 +1,48 @@
+#pragma once
+#include "graph.h"
+#include "grid.h"
+#include "pqueue.h"
+
+/* Search state for one tile; tiles are searched in local coordinates
+	(local = (x - tile's first row) * tile width + (y - tile's first column))
+**************************************************************************/
+typedef struct tileScratch {
+	IndexedHeap queue;
+	int *distance;
+	int *previous;		// Local index of previous cell, or -1
+} TileScratch;
+
+/* Hierarchical (HPA*) planner over a grid graph.
+	The grid is split into tileSize x tileSize tiles. Along each border between two
+	tiles, pairs of facing cells every portalStep cells (and at the end of the border)
+	become portals. The abstract graph joins portals in the same tile by their
+	shortest distance inside the tile, and facing portals by their single move.
+
+	A route is planned on the abstract graph, then only the tiles along it are
+	searched to recover cells. Paths are restricted to tile crossings at portals,
+	so costs may exceed the exact shortest path (see hpa_optimality_gap()).
+**************************************************************************/
+typedef struct hpaPlanner {
+	GridGraph *grid;			// Not owned
+	int tileSize;
+	int tileRows;
+	int tileCols;
+	int portalCount;
+	int *portalCell;			// portalCell[p] = grid vertex of portal p
+	int *tileOffsets;			// Portals of tile t are tilePortals[tileOffsets[t]] .. [tileOffsets[t+1] - 1]
+	int *tilePortals;
+	CsrGraph abstract;			// Portal graph
+	TileScratch scratch;		// For queries (a planner answers one query at a time)
+	IndexedHeap queue;			// Abstract search state, per portal
+	int *distance;
+	int *previous;
+	int *targetCost;			// Cost from portal to target, or INT_MAX
+} HpaPlanner;
+
+// Functions for building/destroying planners
+HpaPlanner new_hpa_planner(GridGraph *grid, int tileSize, int portalStep, int threads);
+void destroy_hpa_planner(HpaPlanner *self);
+
+// Route queries; return cost (INT_MAX if unreachable)
+int hpa_route(HpaPlanner *self, int source, int target, int* path, int capacity, int* pathLength);
+double hpa_optimality_gap(HpaPlanner *self, int source, int target);
@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "isochrone.h"
+
+/* Bounded multi-source Dijkstra
+	Takes graph, workspace (built for graph->V vertices), array of source vertices, and
+	budget; every source starts at cost 0
+	Writes reachable vertices into 'vertices' (up to capacity entries; may be NULL) and
+	sets their bits in 'bitmap' (ISOCHRONE_BITMAP_BYTES(graph->V) bytes, cleared by the
+	caller; may be NULL). Bits are only ever set, so one bitmap can collect the union of
+	several queries.
+	Returns number of reachable vertices (which may exceed capacity)
+*********************************************************************************************/
+int isochrone(CsrGraph *graph, Workspace *ws, const int *sources, int sourceCount, int budget,
+	int *vertices, int capacity, unsigned char *bitmap) {
+
+	workspace_begin(ws);
+	unsigned gen = ws->generation;
+	int count = 0;
+
+	for (int i = 0; i < sourceCount; i++) {
+		int source = sources[i];
+		if (ws->reached[source] != gen && budget >= 0) {	// Sources listed twice are queued once
+			ws->reached[source] = gen;
+			ws->distance[source] = 0;
+			ws->previous[source] = -1;
+			heap_push(&ws->queue, source, 0);
+		}
+	}
+
+	while (!heap_is_empty(&ws->queue) && heap_min_key(&ws->queue) <= budget) {
+		int nearNode = heap_pop(&ws->queue);
+		ws->settled[nearNode] = gen;
+		if (count < capacity && vertices != NULL) {
+			vertices[count] = nearNode;
+		}
+		if (bitmap != NULL) {
+			bitmap[nearNode / 8] |= (unsigned char)(1 << (nearNode % 8));
+		}
+		count++;
+
+		for (int e = graph->offsets[nearNode]; e < graph->offsets[nearNode + 1]; e++) {
+			int to = graph->to_vertex[e];
+			if (ws->settled[to] != gen) {
+				int alt = graph->weight[e] + ws->distance[nearNode];
+				if (ws->reached[to] != gen || alt < ws->distance[to]) {
+					ws->reached[to] = gen;
+					ws->distance[to] = alt;
+					ws->previous[to] = nearNode;
+					heap_push(&ws->queue, to, alt);
+				}
+			}
+		}
+	}
+
+	// Vertices still queued were reached, but over budget; generation 0 is never current
+	for (int i = 0; i < ws->queue.size; i++) {
+		ws->reached[ws->queue.heap[i]] = 0;
+	}
+	heap_clear(&ws->queue);
+	return count;
+}
+
+/* Returns 1 if vertex's bit is set in a bitmap filled by isochrone(), otherwise 0
+***********************************************************************************/
+int bitmap_contains(const unsigned char *bitmap, int vertex) {
+	return (bitmap[vertex / 8] >> (vertex % 8)) & 1;
+}
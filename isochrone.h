@@ -0,0 +1,22 @@
+#pragma once
+#include "graph.h"
+#include "batch.h"
+
+/* Bounded searches: which vertices can be reached from any of a set of sources with
+	total cost <= budget.
+	The search stops as soon as the queue minimum exceeds the budget, and runs on a
+	Workspace, so its cost depends on the reachable area rather than |V|. Edge weights
+	must be non-negative (e.g. cost_funcA); with negative weights a vertex could still
+	come within budget after the search has stopped.
+
+	Results are written to a sparse list of vertices (in order of increasing cost)
+	and/or a bitmap with bit v % 8 of byte v / 8 set for each reachable vertex v; costs
+	stay readable through workspace_distance() until the workspace's next query.
+**************************************************************************/
+
+// Bytes needed for a reachability bitmap over vertexCount vertices
+#define ISOCHRONE_BITMAP_BYTES(vertexCount) (((size_t)(vertexCount) + 7) / 8)
+
+int isochrone(CsrGraph *graph, Workspace *ws, const int *sources, int sourceCount, int budget,
+	int* vertices, int capacity, unsigned char *bitmap);
+int bitmap_contains(const unsigned char *bitmap, int vertex);
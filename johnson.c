@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <stddef.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "johnson.h"
+#include "pqueue.h"
+#include "stats.h"
+
+/* Bellman-Ford potentials
+	Takes a graph and an array of length = vertex count
+	Computes, in 'potential', shortest distances from a virtual vertex with a zero-weight
+	edge to every vertex. Only vertices whose potential just changed are requeued (SPFA).
+	Returns 1 on success, or 0 if the graph contains a negative cycle
+*********************************************************************************************/
+int bellman_ford_potentials(CsrGraph *self, int *potential) {
+
+	int vertexCount = self->V;
+	int *queue = malloc(vertexCount * sizeof(int));		// Circular FIFO, holds each vertex once
+	int *passes = malloc(vertexCount * sizeof(int));	// Times each vertex has been dequeued
+	char *queued = malloc(vertexCount);
+	int head = 0;
+	int count = vertexCount;
+	int ok = 1;
+
+	for (int v = 0; v < vertexCount; v++) {		// Virtual edges give every vertex potential 0
+		potential[v] = 0;
+		queue[v] = v;
+		passes[v] = 0;
+		queued[v] = 1;
+	}
+
+	while (count > 0) {
+		int u = queue[head];
+		head = head + 1 == vertexCount ? 0 : head + 1;
+		count--;
+		queued[u] = 0;
+
+		if (++passes[u] > vertexCount) {			// Still improving after |V| rounds
+			ok = 0;
+			break;
+		}
+
+		for (int e = self->offsets[u]; e < self->offsets[u + 1]; e++) {
+			int to = self->to_vertex[e];
+			int alt = potential[u] + self->weight[e];
+			if (alt < potential[to]) {
+				potential[to] = alt;
+				if (!queued[to]) {
+					int tail = head + count;
+					queue[tail >= vertexCount ? tail - vertexCount : tail] = to;
+					count++;
+					queued[to] = 1;
+				}
+			}
+		}
+	}
+
+	free(queue);
+	free(passes);
+	free(queued);
+	return ok;
+}
+
+/* Prepares a graph for Johnson's algorithm
+	Takes a graph (may contain negative edges), and JohnsonGraph to fill
+	Returns 1 on success, or 0 (leaving 'out' empty) if the graph has a negative cycle
+*********************************************************************************************/
+int johnson_prepare(CsrGraph *self, JohnsonGraph *out) {
+
+	int vertexCount = self->V;
+
+	out->potential = malloc(vertexCount * sizeof(int));
+	if (!bellman_ford_potentials(self, out->potential)) {
+		free(out->potential);
+		out->potential = NULL;
+		out->graph = new_csr_graph(0, 0);
+		return 0;
+	}
+
+	out->graph = new_csr_graph(vertexCount, self->E);
+	for (int v = 0; v <= vertexCount; v++) {
+		out->graph.offsets[v] = self->offsets[v];
+	}
+	for (int u = 0; u < vertexCount; u++) {
+		for (int e = self->offsets[u]; e < self->offsets[u + 1]; e++) {
+			int to = self->to_vertex[e];
+			out->graph.to_vertex[e] = to;
+			out->graph.weight[e] = self->weight[e] + out->potential[u] - out->potential[to];
+		}
+	}
+	return 1;
+}
+
+/* Destroys reweighted graph, freeing all memory
+******************************************/
+void destroy_johnson_graph(JohnsonGraph *self) {
+	destroy_csr_graph(&self->graph);
+	free(self->potential);
+	self->potential = NULL;
+}
+
+/* Helper function which converts reweighted distances from source back to original weights
+*********************************************************************************************/
+static void johnson_restore(JohnsonGraph *self, int source, int *distance) {
+	for (int v = 0; v < self->graph.V; v++) {
+		if (distance[v] != INT_MAX) {
+			distance[v] = distance[v] - self->potential[source] + self->potential[v];
+		}
+	}
+}
+
+/* Single-source shortest paths on a prepared graph
+	Same contract as dijkstra(); distances are in the original weights
+*********************************************************************************************/
+void johnson_dijkstra(JohnsonGraph *self, int source, int *distance, int *previous) {
+	dijkstra_csr_with(&self->graph, source, distance, previous, DIJKSTRA_RADIX_HEAP);
+	johnson_restore(self, source, distance);
+}
+
+/* Single-pair shortest path on a prepared graph; stops once target is settled
+	Same contract as dijkstra_csr_target(); returned distance is in the original weights
+*********************************************************************************************/
+int johnson_query(JohnsonGraph *self, int source, int target, int *distance, int *previous) {
+	dijkstra_csr_target(&self->graph, source, target, distance, previous);
+	johnson_restore(self, source, distance);
+	return distance[target];
+}
+
+/* Helper function for johnson_all_pairs(); one Dijkstra search on the reweighted graph
+	Fills row 'source' of the flat distance/next tables, with the same conventions as
+	floyd_warshall(): no path = INT_MAX/2 and -1, and the diagonal holds the shortest
+	cycle through source
+*********************************************************************************************/
+static void johnson_row(JohnsonGraph *self, CsrGraph *reverse, int source, IndexedHeap *queue,
+	int *dist, int *firstHop, int *order, char *visited, int *distRow, int *nextRow) {
+
+	STATS_TIMER_START(timer);
+	CsrGraph *g = &self->graph;
+	int vertexCount = g->V;
+	int settled = 0;
+
+	for (int v = 0; v < vertexCount; v++) {
+		dist[v] = INT_MAX;
+		visited[v] = 0;
+	}
+	dist[source] = 0;
+	firstHop[source] = -1;
+	heap_push(queue, source, 0);
+
+	while (!heap_is_empty(queue)) {
+		int nearNode = heap_pop(queue);
+		visited[nearNode] = 1;
+		order[settled++] = nearNode;
+		STATS_ADD(settled, 1);
+
+		for (int e = g->offsets[nearNode]; e < g->offsets[nearNode + 1]; e++) {
+			int to = g->to_vertex[e];
+			STATS_ADD(relaxed, 1);
+			if (visited[to] == 0) {
+				int alt = g->weight[e] + dist[nearNode];
+				if (alt < dist[to]) {
+					dist[to] = alt;
+					firstHop[to] = nearNode == source ? to : firstHop[nearNode];	// First move on path
+					heap_push(queue, to, alt);
+					STATS_ADD(improved, 1);
+				}
+			}
+		}
+	}
+
+	for (int v = 0; v < vertexCount; v++) {
+		distRow[v] = INT_MAX / 2;
+		nextRow[v] = -1;
+	}
+	for (int i = 1; i < settled; i++) {			// Source itself is handled below
+		int v = order[i];
+		distRow[v] = dist[v] - self->potential[source] + self->potential[v];
+		nextRow[v] = firstHop[v];
+	}
+
+	// Shortest cycle through source: path to a predecessor u, then edge u->source
+	long long best = LLONG_MAX;
+	for (int e = reverse->offsets[source]; e < reverse->offsets[source + 1]; e++) {
+		int u = reverse->to_vertex[e];
+		if (dist[u] != INT_MAX) {
+			long long cycle = (long long)dist[u] + reverse->weight[e];
+			if (cycle < best) {
+				best = cycle;
+				nextRow[source] = u == source ? source : firstHop[u];
+			}
+		}
+	}
+	if (best != LLONG_MAX) {
+		distRow[source] = (int)best;		// Potentials cancel around a cycle
+	}
+	STATS_TIMER_STOP(timer, searchSeconds);
+}
+
+/* Johnson's all-pairs shortest paths
+	Takes a graph (may contain negative edges), two flat row-major |V|x|V| tables, and
+	thread count (<= 0 uses every available core)
+
+	Produces the same distances as floyd_warshall() (with the same INT_MAX/2 and -1 for
+	missing paths) in O(V E log V) time instead of O(V^3); 'next' gives an equally short
+	path where several exist. Tables need not be initialised. One Dijkstra search per
+	source runs on the reweighted graph, spread across threads.
+
+	Returns 1 on success, or 0 if the graph has a negative cycle (tables untouched)
+*********************************************************************************************/
+int johnson_all_pairs(CsrGraph *self, int *distance, int *next, int threads) {
+
+	JohnsonGraph reweighted;
+	if (!johnson_prepare(self, &reweighted)) {
+		return 0;
+	}
+	CsrGraph reverse = csr_transpose(&reweighted.graph);
+
+	johnson_rows(&reweighted, &reverse, 0, self->V, distance, next, threads);
+
+	destroy_csr_graph(&reverse);
+	destroy_johnson_graph(&reweighted);
+	return 1;
+}
+
+/* Fills rows first .. first + count - 1 of the all-pairs tables, as johnson_all_pairs()
+	does, so tables too large to hold whole can be produced a block of rows at a time
+	Takes prepared graph, its reverse (csr_transpose() of self->graph), first source,
+	number of rows, count x |V| flat tables (row r is source first + r), and thread
+	count (<= 0 uses every available core)
+*********************************************************************************************/
+void johnson_rows(JohnsonGraph *self, CsrGraph *reverse, int first, int count, int *distance, int *next, int threads) {
+
+	int vertexCount = self->graph.V;
+	size_t n = (size_t)vertexCount;
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_max_threads();
+	}
+#else
+	threads = 1;
+#endif
+	STATS_PARENT(parent);
+
+	#pragma omp parallel num_threads(threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+		// Per-thread workspace, reused for every source this thread handles
+		IndexedHeap queue = new_heap(vertexCount, 4);
+		int *dist = malloc(vertexCount * sizeof(int));
+		int *firstHop = malloc(vertexCount * sizeof(int));
+		int *order = malloc(vertexCount * sizeof(int));
+		char *visited = malloc(vertexCount);
+		STATS_ADD(bytesAllocated, (size_t)vertexCount * (3 * sizeof(int) + 1));
+
+		#pragma omp for schedule(dynamic, 16)
+		for (int r = 0; r < count; r++) {
+			johnson_row(self, reverse, first + r, &queue, dist, firstHop, order, visited,
+				distance + r * n, next + r * n);
+		}
+
+		destroy_heap(&queue);
+		free(dist);
+		free(firstHop);
+		free(order);
+		free(visited);
+		STATS_WORKER_END(parent);
+	}
+}
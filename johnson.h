@@ -0,0 +1,26 @@
+#pragma once
+#include "graph.h"
+
+/* Graph reweighted for Johnson's algorithm.
+	Each edge u->v of weight w is stored with weight w + potential[u] - potential[v],
+	which is never negative, so Dijkstra can be run on graphs with negative edges
+	(but no negative cycles). Shortest paths are the same in both graphs, and
+	distances convert back as d(u,v) = d'(u,v) - potential[u] + potential[v].
+**************************************************************************/
+typedef struct johnsonGraph {
+	CsrGraph graph;		// Reweighted edges
+	int *potential;		// potential[v] from Bellman-Ford
+} JohnsonGraph;
+
+// Bellman-Ford (queue based, SPFA) from a virtual source joined to every vertex
+int bellman_ford_potentials(CsrGraph *self, int *potential);
+
+// Functions for building/destroying reweighted graphs
+int johnson_prepare(CsrGraph *self, JohnsonGraph *out);
+void destroy_johnson_graph(JohnsonGraph *self);
+
+// Shortest paths with original weights, using the reweighted graph
+void johnson_dijkstra(JohnsonGraph *self, int source, int* distance, int* previous);
+int johnson_query(JohnsonGraph *self, int source, int target, int* distance, int* previous);
+int johnson_all_pairs(CsrGraph *self, int* distance, int* next, int threads);
+void johnson_rows(JohnsonGraph *self, CsrGraph *reverse, int first, int count, int* distance, int* next, int threads);
@@ -1,131 +1,44 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
 #include "graph.h"
+#include "johnson.h"
+#include "apstore.h"
+#include "isochrone.h"
+#include "dem.h"
+#include "stats.h"
+#include "service.h"
 
 /* Function Prototypes
 ************************/
-int** make_dem(int size, int roughness);
-int cost_funcA(int diff);
-int cost_funcB(int diff);
-void print_2D(int** array2D, int size);
-void print_2D_ascii(int** array2D, int size);
-
-int** copy_dem(int** array2D, int size);
-
-// Graph functions
-void build_graph(Graph self, int** array2D, int size, int allowNegativeWeights);
-void possibleMove(Graph self, int** array2D, int size, int sourceVertex, int sourceValue, int x, int y, int allowNegativeWeights);
-
 void fw_complete(int** dem, int size);
-void fw_free_memory(Graph *graph, int **fw_distance, int **fw_next, int vertexCount);
+void fw_free_memory(CsrGraph *graph, int **fw_distance, int **fw_next);
 int** fw_initialise_distance(int vertexCount);
 int** fw_initialise_next(int vertexCount);
 void trace_path_fw(int** dem, int** next, int size);
 
+void johnson_complete(int** dem, int size);
+
+void ap_store_complete(int** dem, int size);
+void trace_path_list(int** dem, int* path, int length, int size);
+
+void isochrone_complete(int** dem, int size, int budget);
+
 void dijkstra_complete(int** dem, int size);
-void dijkstra_free_memory(Graph *graph, int *distance, int* previous);
+void dijkstra_free_memory(CsrGraph *graph, int *distance, int* previous);
 void trace_path_dijkstra(int** dem, int* previous, int size);
 /************************************************************************/
 
 
-/* Map code
+/* Main function
+	With --serve, runs the route service (see service.h) instead of the demo
 ******************/
-int** make_dem(int size, int roughness) {
-	int seed = time(NULL);
-	srand(seed);
-	int** dem = malloc(size * sizeof *dem);
-	for (int x = 0; x < size; x++) {
-		dem[x] = malloc(size * sizeof *dem[x]);
-		for (int y = 0; y < size; y++) {
-			dem[x][y] = -1;
-		}
-	}
-	int r = roughness;
-
-	dem[0][0] = 50 - r / 2 + rand() % r;
-	dem[size - 1][0] = 50 - r / 2 + rand() % r;
-	dem[0][size - 1] = 50 - r / 2 + rand() % r;
-	dem[size - 1][size - 1] = 50 - r / 2 + rand() % r;
-
-	for (int step = (size - 1); step > 0; step /= 2) {
-		r = r > 1 ? r / 2 : r;
-		if (r < 1) r = 1;
-		for (int cx = 0; cx < (size - 1) / step; cx++) {
-			for (int cy = 0; cy < (size - 1) / step; cy++) {
-				int a = dem[cx*step][cy*step];
-				int b = dem[cx*step + step][cy*step];
-				int c = dem[cx*step][cy*step + step];
-				int d = dem[cx*step + step][cy*step + step];
-
-				dem[cx*step + step / 2][cy*step + step / 2] = (a + b + c + d) / 4 + rand() % r - r / 2;
-
-				dem[cx*step + step / 2][cy*step] = (a + b) / 2 + rand() % r - r / 2;
-				dem[cx*step][cy*step + step / 2] = (a + c) / 2 + rand() % r - r / 2;
-				dem[cx*step + step][cy*step + step / 2] = (b + d) / 2 + rand() % r - r / 2;
-				dem[cx*step + step / 2][cy*step + step] = (c + d) / 2 + rand() % r - r / 2;
-			}
-		}
-	}
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-			dem[x][y] = dem[x][y]<0 ? 0 : dem[x][y];
-			dem[x][y] = dem[x][y]>99 ? 99 : dem[x][y];
-		}
-	}
-	return dem;
-}
-
-int cost_funcA(int diff) {
-	int cost = 1;
-	if (diff > 0) cost += diff * diff;
-	return cost;
-}
-
-int cost_funcB(int diff) {
-	int cost = 1;
-	if (diff > 0)
-		cost += diff * diff;
-	else
-		cost += diff;
-	return cost;
-}
-
-void print_2D(int** array2D, int size) {
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-			if (array2D[x][y] >= 0) {
-				printf("%2d ", array2D[x][y]);
-			}
-			else {
-				printf("() ");
-			}
-		}
-		printf("\n");
-	}
-}
+int main(int argc, char *argv[]) {
 
-void print_2D_ascii(int** array2D, int size) {
-	char *shades = " .-:=+*#%@";
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-			if (array2D[x][y] >= 0) {
-				char shade = shades[array2D[x][y] * 10 / 100];
-				printf("%c%c", shade, shade);
-			}
-			else {
-				printf("()");
-			}
-		}
-		printf("\n");
+	if (argc > 1 && strcmp(argv[1], "--serve") == 0) {
+		return service_main(argc - 2, argv + 2);
 	}
-}
-
-
-
-/* Main function
-******************/
-int main() {
 
 	// Set size of map (2^n + 1), and roughness
 	int size =33;
@@ -139,13 +52,40 @@ int main() {
 	printf("\n");
 
 
+	// Work done by each solver is printed if built with -DDIJKSTRA_STATS
+	SearchStats stats;
+
 	// Prints a shortest path and energy cost found using Dijkstra's algorithm
 	// (no regenerative braking)
+	stats_begin(&stats);
 	dijkstra_complete(map, size);
+	stats_end();
+	if (stats_enabled()) print_stats("Dijkstra statistics", &stats);
 
 	// Prints a shortest path and energy cost found using Floyd-Warshall algorithm
 	// (with regenerative braking)
+	stats_begin(&stats);
 	fw_complete(map, size);
+	stats_end();
+	if (stats_enabled()) print_stats("Floyd-Warshall statistics", &stats);
+
+	// Prints the same route found using Johnson's reweighting, without a |V|x|V| table
+	// (with regenerative braking)
+	stats_begin(&stats);
+	johnson_complete(map, size);
+	stats_end();
+	if (stats_enabled()) print_stats("Johnson statistics", &stats);
+
+	// Prints the same route read back from compressed all-pairs tables, part of which
+	// are spilled to a file (with regenerative braking)
+	stats_begin(&stats);
+	ap_store_complete(map, size);
+	stats_end();
+	if (stats_enabled()) print_stats("All-pairs store statistics", &stats);
+
+	// Prints cells reachable from either top corner with an energy budget of 25
+	// (no regenerative braking)
+	isochrone_complete(map, size, 25);
 
 
 	// Free memory for DEM
@@ -165,8 +105,9 @@ Complete Dijkstra implementation
 
  Takes a 2D array (DEM), and the size of DEM
 	- Builds a graph with no negative edge weights,
-	- Calculates shortest paths from vertex 0 (top left of DEM),
-	- Reconstructs path to last vertex (bottom right of DEM),
+	- Calculates shortest path from vertex 0 (top left of DEM) to last vertex
+	  (bottom right of DEM), stopping once the last vertex is reached,
+	- Reconstructs path to last vertex,
 	- Creates copy of DEM with heights changed to -1 for vertices on the path
 	- Prints DEM to show path
 	- Frees all dynamically allocated memory
@@ -181,12 +122,11 @@ void dijkstra_complete(int** dem, int size) {
 	int *previous = malloc(vertexCount*(sizeof(int)));
 
 	// Initialise and build graph
-	Graph graph = new_graph(size*size);
-	build_graph(graph, dem, size, 1); // 0 => Graph contains no negative edge weights
+	CsrGraph graph = build_csr_graph(dem, size, 1); // 0 => Graph contains no negative edge weights
 
 	printf("\n\nDijkstra's Shortest Path:\n");
 
-	dijkstra(&graph, 0, distance, previous);
+	dijkstra_csr_target(&graph, 0, vertexCount - 1, distance, previous);
 	trace_path_dijkstra(dem, previous, size);
 
 	printf("Shortest path energy cost = %d\n", distance[vertexCount - 1]);
@@ -200,7 +140,7 @@ void dijkstra_complete(int** dem, int size) {
 
  Takes a 2D array (DEM), and the size of DEM
 	- Builds a graph which can include negative edge weights,
-	- Calculates all shortest paths using Floyd-Warshall,
+	- Calculates all shortest paths using blocked Floyd-Warshall on all cores,
 	- Reconstructs path form first to last vertex (top left, to bottom right),
 	- Creates copy of DEM with heights changed to -1 for vertices on the path
 	- Prints DEM to show path
@@ -215,94 +155,133 @@ void fw_complete(int** dem, int size) {
 	int** fw_distance = fw_initialise_distance(vertexCount);
 	int** fw_next = fw_initialise_next(vertexCount);
 
-	Graph graph = new_graph(vertexCount);
-	build_graph(graph, dem, size, 1); // 1 => Graph contains negative edge weights
+	CsrGraph graph = build_csr_graph(dem, size, 1); // 1 => Graph contains negative edge weights
 
 
 	printf("\n\nFloyd-Warshall's Shortest Path:\n");
 
-	floyd_warshall(&graph, fw_distance, fw_next);
+	floyd_warshall_blocked(&graph, fw_distance[0], fw_next[0], FW_BLOCK_SIZE, 0);
 	trace_path_fw(dem, fw_next, size);
 
 	printf("Shortest path energy cost = %d\n", fw_distance[0][vertexCount - 1]);
 
-	fw_free_memory(&graph, fw_distance, fw_next, vertexCount);
+	fw_free_memory(&graph, fw_distance, fw_next);
 }
 
 
-/* Helper function used when tracing shortest paths
-   Takes a dem, copies it, returns copy
-****************************************************/
-int** copy_dem(int** array2D, int size) {
+/*
+ Complete Johnson implementation
 
-	int** copy = malloc(size * sizeof *copy);
-	for (int x = 0; x < size; x++) {
-		copy[x] = malloc(size * sizeof *copy[x]);
-		for (int y = 0; y < size; y++) {
-			copy[x][y] = array2D[x][y];
-		}
+ Takes a 2D array (DEM), and the size of DEM
+	- Builds a graph which can include negative edge weights,
+	- Reweights it with Bellman-Ford potentials so no edge is negative,
+	- Calculates shortest path from first to last vertex with Dijkstra on the reweighted graph,
+	- Prints DEM to show path
+	- Frees all dynamically allocated memory
+
+****************************************************************************/
+void johnson_complete(int** dem, int size) {
+
+	int vertexCount = size * size;
+
+	int *distance = malloc(vertexCount*(sizeof(int)));
+	int *previous = malloc(vertexCount*(sizeof(int)));
+
+	CsrGraph graph = build_csr_graph(dem, size, 1); // 1 => Graph contains negative edge weights
+	JohnsonGraph reweighted;
+
+	printf("\n\nJohnson's Shortest Path:\n");
+
+	if (!johnson_prepare(&graph, &reweighted)) {
+		printf("Graph contains a negative cycle\n");
+		dijkstra_free_memory(&graph, distance, previous);
+		return;
 	}
 
-	return copy;
+	johnson_query(&reweighted, 0, vertexCount - 1, distance, previous);
+	trace_path_dijkstra(dem, previous, size);
+
+	printf("Shortest path energy cost = %d\n", distance[vertexCount - 1]);
+
+	destroy_johnson_graph(&reweighted);
+	dijkstra_free_memory(&graph, distance, previous);
 }
 
-/* Takes an empty graph, a DEM, size, and an integer either 0 or != 0.
-
-   Function calculates all possible moves from each vertex [x][y] location of DEM,
-   and adds those edges to the graph using possibleMove() helper function.
-
-   Weights of edges are calculated by possibleMove where:
-
-			allowNegativeWeights = 0,	uses cost_funcA() (edge weights > 0)
-			allowNegativeWeights != 0,	uses cost_funcB() (allows negative edge weights)
-*****************************************************************************************/
-void build_graph(Graph self, int** array2D, int size, int allowNegativeWeights) {
-	for (int x = 0; x < size; x++) {
-		for (int y = 0; y < size; y++) {
-
-			int sourceVertex = x * size + y;
-			int sourceValue = array2D[x][y];
-
-			if (x != 0) {
-				// Can move 'North'
-				possibleMove(self, array2D, size, sourceVertex, sourceValue, x - 1, y, allowNegativeWeights);
-			}
-			if (x != size - 1) {
-				// Can move 'South'
-				possibleMove(self, array2D, size, sourceVertex, sourceValue, x + 1, y, allowNegativeWeights);
-			}
-			if (y != 0) {
-				// Can move 'West'
-				possibleMove(self, array2D, size, sourceVertex, sourceValue, x, y - 1, allowNegativeWeights);
-			}
-			if (y != size - 1) {
-				// Can move 'East'
-				possibleMove(self, array2D, size, sourceVertex, sourceValue, x, y + 1, allowNegativeWeights);
-			}
 
-		}
+/*
+ Complete all-pairs store implementation
+
+ Takes a 2D array (DEM), and the size of DEM
+	- Builds a graph which can include negative edge weights,
+	- Calculates all shortest paths a tile of rows at a time, compressing each tile and
+	  keeping 256 KB of them in memory (the rest go to a spill file),
+	- Reads path from first to last vertex back from the compressed tables,
+	- Prints DEM to show path
+	- Frees all dynamically allocated memory, and removes the spill file
+
+****************************************************************************/
+void ap_store_complete(int** dem, int size) {
+
+	int vertexCount = size * size;
+
+	int *path = malloc(vertexCount*(sizeof(int)));
+
+	CsrGraph graph = build_csr_graph(dem, size, 1); // 1 => Graph contains negative edge weights
+	AllPairsStore store;
+
+	printf("\n\nAll-Pairs Store Shortest Path:\n");
+
+	if (!ap_store_build(&graph, 256 * 1024, "apstore.spill", 0, &store)) {
+		printf("Graph contains a negative cycle, or spill file could not be written\n");
+		free(path);
+		destroy_csr_graph(&graph);
+		return;
 	}
+
+	int length = ap_store_path(&store, 0, vertexCount - 1, path, vertexCount);
+	trace_path_list(dem, path, length, size);
+
+	printf("Shortest path energy cost = %d\n", ap_store_distance(&store, 0, vertexCount - 1));
+	printf("Tables: %zu bytes in memory, %zu bytes in spill file (%zu uncompressed)\n",
+		store.memoryBytes, store.fileBytes, (size_t)vertexCount * vertexCount * 2 * sizeof(int));
+
+	destroy_ap_store(&store);
+	free(path);
+	destroy_csr_graph(&graph);
 }
 
-/* Helper function for buid_graph function above.
-Takes Graph, DEM, size, source vertex, its value, x and y values, and integer to allow for negative weights
-Adds edge from source vertex to destination vertex, costed according to 'allowNegativeWeights'
-*****************************************************************************************************************/
-void possibleMove(Graph self, int** array2D, int size, int sourceVertex, int sourceValue, int x, int y, int allowNegativeWeights) {
 
-	int destinationVertex = x * size + y;
-	int destinationVertexValue = array2D[x][y];
+/*
+ Complete isochrone implementation
 
-	int cost;	// Dependent on allowNegativeWeights
+ Takes a 2D array (DEM), the size of DEM, and an energy budget
+	- Builds a graph with no negative edge weights,
+	- Finds every vertex reachable from the top left or top right vertex within budget,
+	  stopping once the cheapest vertex left costs more,
+	- Prints DEM to show reachable vertices
+	- Frees all dynamically allocated memory
 
-	if (allowNegativeWeights == 0) {		// Edge weights > 0
-		cost = cost_funcA(destinationVertexValue - sourceValue);
-	}
-	else {									// Negative weights permitted
-		cost = cost_funcB(destinationVertexValue - sourceValue);
-	}
-	
-	add_edge(&self, sourceVertex, destinationVertex, cost);
+****************************************************************************/
+void isochrone_complete(int** dem, int size, int budget) {
+
+	int vertexCount = size * size;
+	int sources[] = { 0, size - 1 };
+
+	int *reachable = malloc(vertexCount*(sizeof(int)));
+
+	CsrGraph graph = build_csr_graph(dem, size, 0); // 0 => Graph contains no negative edge weights
+	Workspace ws = new_workspace(vertexCount);
+
+	printf("\n\nCells Reachable With Budget %d:\n", budget);
+
+	int count = isochrone(&graph, &ws, sources, 2, budget, reachable, vertexCount, NULL);
+	trace_path_list(dem, reachable, count, size);
+
+	printf("%d of %d cells reachable\n", count, vertexCount);
+
+	destroy_workspace(&ws);
+	free(reachable);
+	destroy_csr_graph(&graph);
 }
 
 
@@ -312,6 +291,7 @@ void possibleMove(Graph self, int** array2D, int size, int sourceVertex, int sou
 void trace_path_dijkstra(int** dem, int* previous, int size) {
 
 	int** map = copy_dem(dem, size);  // Copies DEM
+	STATS_TIMER_START(timer);
 
 	map[size - 1][size - 1] = -1; // Marks last vertex as visited
 	int steps = previous[size*size-1];// Gets previous of final vertex
@@ -320,6 +300,7 @@ void trace_path_dijkstra(int** dem, int* previous, int size) {
 		map[steps / size][steps%size] = -1;
 		steps = previous[steps];
 	}
+	STATS_TIMER_STOP(timer, pathSeconds);
 
 	print_2D_ascii(map, size);
 
@@ -336,6 +317,7 @@ void trace_path_dijkstra(int** dem, int* previous, int size) {
 void trace_path_fw(int** dem, int** next, int size) {
 
 	int** map = copy_dem(dem, size);  // Copies DEM
+	STATS_TIMER_START(timer);
 
 	map[0][0] = -1;				  // Marks source as visited
 	map[size - 1][size - 1] = -1; // Marks last vertex as visited
@@ -346,6 +328,29 @@ void trace_path_fw(int** dem, int** next, int size) {
 		map[steps / size][steps%size] = -1;
 		steps = next[steps][0];
 	}
+	STATS_TIMER_STOP(timer, pathSeconds);
+
+	print_2D_ascii(map, size);
+
+	// Free memory
+	for (int i = 0; i < size; i++) {
+		free(map[i]);
+	}
+	free(map);
+}
+
+/* Takes DEM, list of vertices (e.g. on a path) and its length, size of DEM
+   Marks the vertices on a copy of DEM, and prints result
+*********************************************************************/
+void trace_path_list(int** dem, int* path, int length, int size) {
+
+	int** map = copy_dem(dem, size);  // Copies DEM
+	STATS_TIMER_START(timer);
+
+	for (int i = 0; i < length; i++) {
+		map[path[i] / size][path[i] % size] = -1;
+	}
+	STATS_TIMER_STOP(timer, pathSeconds);
 
 	print_2D_ascii(map, size);
 
@@ -357,13 +362,18 @@ void trace_path_fw(int** dem, int** next, int size) {
 }
 
 /* Helper functions to allocate memory for, and initialise 2D arrays for Floyd-Warshall
+   Each table is a single contiguous row-major buffer (table[0]) with row pointers into it,
+   so it can be passed to floyd_warshall_blocked() as table[0] and to trace_path_fw() as is.
    Takes number of vertices, returns 2D 'distance' array
 ******************************************************************************************/
 int** fw_initialise_distance(int vertexCount) {
 
+	size_t n = (size_t)vertexCount;
 	int** fwDist = malloc(vertexCount * sizeof *fwDist);
+	fwDist[0] = malloc(n * n * sizeof *fwDist[0]);
+	STATS_ADD(bytesAllocated, n * n * sizeof *fwDist[0] + n * sizeof *fwDist);
 	for (int x = 0; x < vertexCount; x++) {
-		fwDist[x] = malloc(vertexCount * sizeof *fwDist[x]);
+		fwDist[x] = fwDist[0] + x * n;
 		for (int y = 0; y < vertexCount; y++) {
 			fwDist[x][y] = INT_MAX/2; // Note: we can't use INT_MAX due to errors testing
 		}							  // inequalities in algorithm:
@@ -374,9 +384,12 @@ int** fw_initialise_distance(int vertexCount) {
 *****************************************************/
 int** fw_initialise_next(int vertexCount) {
 
+	size_t n = (size_t)vertexCount;
 	int** fwNext = malloc(vertexCount * sizeof *fwNext);
+	fwNext[0] = malloc(n * n * sizeof *fwNext[0]);
+	STATS_ADD(bytesAllocated, n * n * sizeof *fwNext[0] + n * sizeof *fwNext);
 	for (int x = 0; x < vertexCount; x++) {
-		fwNext[x] = malloc(vertexCount * sizeof *fwNext[x]);
+		fwNext[x] = fwNext[0] + x * n;
 		for (int y = 0; y < vertexCount; y++) {
 			fwNext[x][y] = -1;
 		}
@@ -386,20 +399,18 @@ int** fw_initialise_next(int vertexCount) {
 
 /* Frees all dynamically allocated memory used in Dijkstra's algorithm, including graph
 ****************************************************************************************/
-void dijkstra_free_memory(Graph *graph, int *distance, int* previous) {
+void dijkstra_free_memory(CsrGraph *graph, int *distance, int* previous) {
 	free(distance);
 	free(previous);
-	destroy_graph(graph);
+	destroy_csr_graph(graph);
 }
 
 /* Frees all dynamically allocated memory used in Floyd-Warshall algorithm, including graph
 ********************************************************************************************/
-void fw_free_memory(Graph *graph, int **fw_distance, int **fw_next, int vertexCount) {
-	for (int i = 0; i < vertexCount; i++) {
-		free(fw_distance[i]);
-		free(fw_next[i]);
-	}
+void fw_free_memory(CsrGraph *graph, int **fw_distance, int **fw_next) {
+	free(fw_distance[0]);		// Tables are single buffers (see fw_initialise_distance())
+	free(fw_next[0]);
 	free(fw_distance);
 	free(fw_next);
-	destroy_graph(graph);
+	destroy_csr_graph(graph);
 }
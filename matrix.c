@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "matrix.h"
+#include "stats.h"
+
+/* One bucket entry: 'target' (index into targets) is 'distance' above a vertex
+**************************************************************************/
+typedef struct bucketEntry {
+	int target;
+	int distance;
+} BucketEntry;
+
+/* Helper function which runs a complete search from start over an upward graph of a
+	hierarchy, listing settled vertices in *settled (grown as needed)
+	Returns number of vertices settled; distances stay in the workspace
+**************************************************************************/
+static int upward_search(CsrGraph *graph, Workspace *ws, int start, int **settled, int *capacity) {
+
+	workspace_begin(ws);
+	unsigned gen = ws->generation;
+	int count = 0;
+
+	ws->reached[start] = gen;
+	ws->distance[start] = 0;
+	ws->previous[start] = -1;
+	heap_push(&ws->queue, start, 0);
+
+	while (!heap_is_empty(&ws->queue)) {
+		int v = heap_pop(&ws->queue);
+		ws->settled[v] = gen;
+		if (count == *capacity) {
+			*capacity *= 2;
+			*settled = realloc(*settled, *capacity * sizeof(int));
+		}
+		(*settled)[count++] = v;
+
+		for (int e = graph->offsets[v]; e < graph->offsets[v + 1]; e++) {
+			int to = graph->to_vertex[e];
+			if (ws->settled[to] != gen) {
+				int alt = ws->distance[v] + graph->weight[e];
+				if (ws->reached[to] != gen || alt < ws->distance[to]) {
+					ws->reached[to] = gen;
+					ws->distance[to] = alt;
+					ws->previous[to] = v;
+					heap_push(&ws->queue, to, alt);
+				}
+			}
+		}
+	}
+	return count;
+}
+
+/* Distance table by target-pruned Dijkstra
+	Takes graph, pool (built for graph->V vertices), sources and targets, table of
+	sourceCount * targetCount entries, and optional path buffers (see matrix.h)
+	Sources are shared across the pool's threads
+*********************************************************************************************/
+void many_to_many(CsrGraph *graph, QueryPool *pool, const int *sources, int sourceCount,
+	const int *targets, int targetCount, int *table, int **paths, int pathCapacity, int *pathLengths) {
+
+	char *isTarget = calloc(graph->V, 1);
+	int distinct = 0;
+	for (int j = 0; j < targetCount; j++) {
+		distinct += !isTarget[targets[j]];
+		isTarget[targets[j]] = 1;
+	}
+
+	STATS_PARENT(parent);
+	#pragma omp parallel num_threads(pool->threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+		#pragma omp for schedule(dynamic)
+		for (int i = 0; i < sourceCount; i++) {
+#ifdef _OPENMP
+			Workspace *ws = &pool->workspaces[omp_get_thread_num()];
+#else
+			Workspace *ws = &pool->workspaces[0];
+#endif
+			workspace_begin(ws);
+			unsigned gen = ws->generation;
+			int remaining = distinct;
+
+			ws->reached[sources[i]] = gen;
+			ws->distance[sources[i]] = 0;
+			ws->previous[sources[i]] = -1;
+			heap_push(&ws->queue, sources[i], 0);
+
+			while (remaining > 0 && !heap_is_empty(&ws->queue)) {
+				int nearNode = heap_pop(&ws->queue);
+				ws->settled[nearNode] = gen;
+				remaining -= isTarget[nearNode];		// Stop once every target is final
+
+				for (int e = graph->offsets[nearNode]; e < graph->offsets[nearNode + 1]; e++) {
+					int to = graph->to_vertex[e];
+					if (ws->settled[to] != gen) {
+						int alt = graph->weight[e] + ws->distance[nearNode];
+						if (ws->reached[to] != gen || alt < ws->distance[to]) {
+							ws->reached[to] = gen;
+							ws->distance[to] = alt;
+							ws->previous[to] = nearNode;
+							heap_push(&ws->queue, to, alt);
+						}
+					}
+				}
+			}
+
+			for (int j = 0; j < targetCount; j++) {
+				size_t cell = (size_t)i * targetCount + j;
+				table[cell] = workspace_distance(ws, targets[j]);
+				if (paths != NULL && pathLengths != NULL) {
+					pathLengths[cell] = workspace_path(ws, targets[j], paths[cell], pathCapacity);
+				}
+			}
+		}
+		STATS_WORKER_END(parent);
+	}
+
+	free(isTarget);
+}
+
+/* Distance table by bucket-based search on a contraction hierarchy
+	Takes hierarchy, pool (built for ch->V vertices), sources and targets, and table of
+	sourceCount * targetCount entries
+	Target searches, then source searches, are shared across the pool's threads
+*********************************************************************************************/
+void ch_many_to_many(ContractionHierarchy *ch, QueryPool *pool, const int *sources, int sourceCount,
+	const int *targets, int targetCount, int *table) {
+
+	int vertexCount = ch->V;
+	int threads = pool->threads;
+	int **found = calloc(threads, sizeof(int *));			// Per thread: (vertex, target, distance) triples
+	int *foundCount = calloc(threads, sizeof(int));
+	int *bucketOffsets = calloc(vertexCount + 1, sizeof(int));
+
+	// Target searches: every vertex reached gets a bucket entry
+	STATS_PARENT(parent);
+	#pragma omp parallel num_threads(threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+#ifdef _OPENMP
+		int t = omp_get_thread_num();
+#else
+		int t = 0;
+#endif
+		Workspace *ws = &pool->workspaces[t];
+		int capacity = 256;
+		int *settled = malloc(capacity * sizeof(int));
+		int foundCapacity = 1024;
+		found[t] = malloc(foundCapacity * 3 * sizeof(int));
+
+		#pragma omp for schedule(dynamic)
+		for (int j = 0; j < targetCount; j++) {
+			int count = upward_search(&ch->down, ws, targets[j], &settled, &capacity);
+			if (foundCount[t] + count > foundCapacity) {
+				while (foundCount[t] + count > foundCapacity) {
+					foundCapacity *= 2;
+				}
+				found[t] = realloc(found[t], foundCapacity * 3 * sizeof(int));
+			}
+			for (int k = 0; k < count; k++) {
+				int *entry = found[t] + 3 * foundCount[t]++;
+				entry[0] = settled[k];
+				entry[1] = j;
+				entry[2] = ws->distance[settled[k]];
+			}
+		}
+		free(settled);
+		STATS_WORKER_END(parent);
+	}
+
+	// Gather entries into buckets, stored contiguously per vertex
+	for (int t = 0; t < threads; t++) {
+		for (int k = 0; k < foundCount[t]; k++) {
+			bucketOffsets[found[t][3 * k] + 1]++;
+		}
+	}
+	for (int v = 0; v < vertexCount; v++) {
+		bucketOffsets[v + 1] += bucketOffsets[v];
+	}
+	BucketEntry *buckets = malloc((bucketOffsets[vertexCount] + 1) * sizeof(BucketEntry));
+	int *fill = malloc(vertexCount * sizeof(int));
+	for (int v = 0; v < vertexCount; v++) {
+		fill[v] = bucketOffsets[v];
+	}
+	for (int t = 0; t < threads; t++) {
+		for (int k = 0; k < foundCount[t]; k++) {
+			int *entry = found[t] + 3 * k;
+			buckets[fill[entry[0]]].target = entry[1];
+			buckets[fill[entry[0]]++].distance = entry[2];
+		}
+		free(found[t]);
+	}
+	free(fill);
+	free(found);
+	free(foundCount);
+
+	// Source searches: every vertex reached offers a route to each target in its bucket
+	#pragma omp parallel num_threads(threads)
+	{
+		STATS_WORKER_BEGIN(parent);
+#ifdef _OPENMP
+		Workspace *ws = &pool->workspaces[omp_get_thread_num()];
+#else
+		Workspace *ws = &pool->workspaces[0];
+#endif
+		int capacity = 256;
+		int *settled = malloc(capacity * sizeof(int));
+
+		#pragma omp for schedule(dynamic)
+		for (int i = 0; i < sourceCount; i++) {
+			int *row = table + (size_t)i * targetCount;
+			for (int j = 0; j < targetCount; j++) {
+				row[j] = INT_MAX;
+			}
+			int count = upward_search(&ch->up, ws, sources[i], &settled, &capacity);
+			for (int k = 0; k < count; k++) {
+				int v = settled[k];
+				int d = ws->distance[v];
+				for (int b = bucketOffsets[v]; b < bucketOffsets[v + 1]; b++) {
+					int alt = d + buckets[b].distance;
+					if (alt < row[buckets[b].target]) {
+						row[buckets[b].target] = alt;
+					}
+				}
+			}
+		}
+		free(settled);
+		STATS_WORKER_END(parent);
+	}
+
+	free(buckets);
+	free(bucketOffsets);
+}
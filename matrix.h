@@ -0,0 +1,24 @@
+#pragma once
+#include "graph.h"
+#include "batch.h"
+#include "ch.h"
+
+/* Many-to-many distance tables: table[i * targetCount + j] = distance from sources[i]
+	to targets[j] (INT_MAX if unreachable). Memory is the S x T table plus each thread's
+	workspace; no |V|x|V| table is built. Edge weights must be non-negative.
+
+	many_to_many() runs one Dijkstra per source on the pool's workspaces, each stopping
+	as soon as every target is settled. Optional paths: paths[i * targetCount + j] is a
+	buffer of pathCapacity vertices, and pathLengths[i * targetCount + j] receives its
+	length as for workspace_path() (both NULL to skip).
+
+	ch_many_to_many() uses a contraction hierarchy: an upward search from every target
+	leaves (target, distance) entries in a bucket at each vertex it reaches, then an
+	upward search from every source reads the buckets of the vertices it reaches. Both
+	searches only cover a few hundred vertices, however far apart sources and targets
+	are. Paths can then be fetched with ch_query() for the pairs that need them.
+**************************************************************************/
+void many_to_many(CsrGraph *graph, QueryPool *pool, const int *sources, int sourceCount,
+	const int *targets, int targetCount, int* table, int** paths, int pathCapacity, int* pathLengths);
+void ch_many_to_many(ContractionHierarchy *ch, QueryPool *pool, const int *sources, int sourceCount,
+	const int *targets, int targetCount, int* table);
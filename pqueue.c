@@ -0,0 +1,398 @@
+#include <stdlib.h>
+#include <limits.h>
+#include "pqueue.h"
+#include "stats.h"
+
+/* Helper function which orders two vertices by key.
+	Ties are broken on vertex number, so vertices are removed in the same
+	order the linear scan in array_minimum() would pick them.
+**************************************************************************/
+static int heap_less(IndexedHeap *self, int a, int b) {
+	if (self->key[a] != self->key[b]) {
+		return self->key[a] < self->key[b];
+	}
+	return a < b;
+}
+
+/* Helper function which places vertex in heap slot, updating its position
+**************************************************************************/
+static void heap_place(IndexedHeap *self, int slot, int vertex) {
+	self->heap[slot] = vertex;
+	self->position[vertex] = slot;
+}
+
+/* Moves vertex at slot towards the root until heap order is restored
+**************************************************************************/
+static void heap_sift_up(IndexedHeap *self, int slot) {
+	int vertex = self->heap[slot];
+
+	while (slot > 0) {
+		int parent = (slot - 1) / self->arity;
+		if (!heap_less(self, vertex, self->heap[parent])) {
+			break;
+		}
+		heap_place(self, slot, self->heap[parent]);	// Move parent down
+		slot = parent;
+	}
+	heap_place(self, slot, vertex);
+}
+
+/* Moves vertex at slot towards the leaves until heap order is restored
+**************************************************************************/
+static void heap_sift_down(IndexedHeap *self, int slot) {
+	int vertex = self->heap[slot];
+
+	while (1) {
+		int first = slot * self->arity + 1;
+		if (first >= self->size) {
+			break;
+		}
+		int last = first + self->arity;
+		if (last > self->size) {
+			last = self->size;
+		}
+
+		int best = first;						// Find smallest child
+		for (int child = first + 1; child < last; child++) {
+			if (heap_less(self, self->heap[child], self->heap[best])) {
+				best = child;
+			}
+		}
+		if (!heap_less(self, self->heap[best], vertex)) {
+			break;
+		}
+		heap_place(self, slot, self->heap[best]);	// Move child up
+		slot = best;
+	}
+	heap_place(self, slot, vertex);
+}
+
+/* Initialises a new, empty, heap able to index vertices 0..capacity-1
+	Takes number of vertices, and number of children per node (>= 2)
+	Returns empty heap
+*********************************************/
+IndexedHeap new_heap(int capacity, int arity) {
+
+	IndexedHeap new_heap;
+
+	new_heap.arity = arity < 2 ? 2 : arity;
+	new_heap.size = 0;
+	new_heap.capacity = capacity;
+	new_heap.heap = malloc(capacity * sizeof(int));
+	new_heap.position = malloc(capacity * sizeof(int));
+	new_heap.key = malloc(capacity * sizeof(int));
+	STATS_ADD(bytesAllocated, 3 * (long long)capacity * sizeof(int));
+
+	for (int i = 0; i < capacity; i++) {
+		new_heap.position[i] = -1;		// No vertex is in the heap
+	}
+
+	return new_heap;
+}
+
+/* Destroys heap, freeing all memory
+******************************************/
+void destroy_heap(IndexedHeap *self) {
+	free(self->heap);
+	free(self->position);
+	free(self->key);
+	self->size = 0;
+}
+
+/* Empties heap so it can be reused.
+	Only vertices still in the heap are touched, so this is O(size), not O(V)
+**************************************************************************/
+void heap_clear(IndexedHeap *self) {
+	for (int i = 0; i < self->size; i++) {
+		self->position[self->heap[i]] = -1;
+	}
+	self->size = 0;
+}
+
+/* Returns true if heap holds no vertices
+******************************************/
+int heap_is_empty(IndexedHeap *self) {
+	return self->size == 0;
+}
+
+/* Returns true if vertex is currently in heap
+**********************************************/
+int heap_contains(IndexedHeap *self, int vertex) {
+	return self->position[vertex] != -1;
+}
+
+/* Inserts vertex with key, or decreases its key if already in heap.
+	A larger key for a vertex already in the heap is ignored.
+**************************************************************************/
+void heap_push(IndexedHeap *self, int vertex, int key) {
+
+	int slot = self->position[vertex];
+
+	if (slot == -1) {							// New vertex goes at the end
+		self->key[vertex] = key;
+		slot = self->size++;
+		heap_place(self, slot, vertex);
+	}
+	else if (key < self->key[vertex]) {		// Decrease-key in place
+		self->key[vertex] = key;
+	}
+	else {
+		return;
+	}
+	STATS_ADD(pushes, 1);
+	heap_sift_up(self, slot);
+}
+
+/* Removes vertex with smallest key from heap
+	Returns that vertex, or -1 if heap is empty
+**********************************************/
+int heap_pop(IndexedHeap *self) {
+
+	if (self->size == 0) {
+		return -1;
+	}
+
+	int top = self->heap[0];
+	self->position[top] = -1;
+	STATS_ADD(pops, 1);
+
+	self->size--;
+	if (self->size > 0) {						// Move last vertex to root
+		heap_place(self, 0, self->heap[self->size]);
+		heap_sift_down(self, 0);
+	}
+	return top;
+}
+
+/* Returns smallest key in heap, or INT_MAX if heap is empty
+*************************************************************/
+int heap_min_key(IndexedHeap *self) {
+	if (self->size == 0) {
+		return INT_MAX;
+	}
+	return self->key[self->heap[0]];
+}
+
+
+
+/* Initialises a new, empty, bucket queue able to index vertices 0..capacity-1
+	Takes number of vertices, and largest edge weight (>= 0)
+*********************************************/
+BucketQueue new_bucket_queue(int capacity, int maxWeight) {
+
+	BucketQueue queue;
+
+	queue.bucketCount = maxWeight + 1;
+	queue.size = 0;
+	queue.current = 0;
+	queue.head = malloc(queue.bucketCount * sizeof(int));
+	queue.next = malloc(capacity * sizeof(int));
+	queue.prev = malloc(capacity * sizeof(int));
+	queue.key = malloc(capacity * sizeof(int));
+	queue.queued = calloc(capacity, 1);
+	STATS_ADD(bytesAllocated, (long long)queue.bucketCount * sizeof(int) + 3 * (long long)capacity * sizeof(int) + capacity);
+
+	for (int b = 0; b < queue.bucketCount; b++) {
+		queue.head[b] = -1;
+	}
+
+	return queue;
+}
+
+/* Destroys bucket queue, freeing all memory
+******************************************/
+void destroy_bucket_queue(BucketQueue *self) {
+	free(self->head);
+	free(self->next);
+	free(self->prev);
+	free(self->key);
+	free(self->queued);
+	self->size = 0;
+}
+
+/* Returns true if bucket queue holds no vertices
+**************************************************/
+int bucket_is_empty(BucketQueue *self) {
+	return self->size == 0;
+}
+
+/* Helper function which removes vertex from its bucket's list
+***************************************************************/
+static void bucket_unlink(BucketQueue *self, int vertex) {
+
+	int b = self->key[vertex] % self->bucketCount;
+
+	if (self->prev[vertex] != -1) {
+		self->next[self->prev[vertex]] = self->next[vertex];
+	}
+	else {
+		self->head[b] = self->next[vertex];
+	}
+	if (self->next[vertex] != -1) {
+		self->prev[self->next[vertex]] = self->prev[vertex];
+	}
+}
+
+/* Inserts vertex with key, or moves it to a smaller key if already queued.
+	Key must be >= the last key popped, and at most maxWeight above it.
+**************************************************************************/
+void bucket_push(BucketQueue *self, int vertex, int key) {
+
+	if (self->queued[vertex]) {
+		if (key >= self->key[vertex]) {
+			return;
+		}
+		bucket_unlink(self, vertex);			// Decrease-key: move between buckets
+	}
+	else {
+		self->queued[vertex] = 1;
+		self->size++;
+	}
+	STATS_ADD(pushes, 1);
+
+	int b = key % self->bucketCount;
+	self->key[vertex] = key;
+	self->prev[vertex] = -1;
+	self->next[vertex] = self->head[b];
+	if (self->head[b] != -1) {
+		self->prev[self->head[b]] = vertex;
+	}
+	self->head[b] = vertex;
+}
+
+/* Removes a vertex with smallest key
+	Returns that vertex, or -1 if queue is empty
+**********************************************/
+int bucket_pop(BucketQueue *self) {
+
+	if (self->size == 0) {
+		return -1;
+	}
+
+	int b = self->current % self->bucketCount;
+	while (self->head[b] == -1) {				// Advance to next non-empty bucket
+		self->current++;
+		b = b + 1 == self->bucketCount ? 0 : b + 1;
+	}
+
+	int vertex = self->head[b];
+	bucket_unlink(self, vertex);
+	STATS_ADD(pops, 1);
+	self->queued[vertex] = 0;
+	self->size--;
+	return vertex;
+}
+
+
+/* Helper function returning radix heap bucket for key: bit length of (key XOR last)
+**************************************************************************/
+static int radix_bucket(unsigned key, unsigned last) {
+
+	unsigned diff = key ^ last;
+	if (diff == 0) {
+		return 0;
+	}
+#if defined(__GNUC__)
+	return 32 - __builtin_clz(diff);
+#else
+	int bits = 0;
+	while (diff) {
+		bits++;
+		diff >>= 1;
+	}
+	return bits;
+#endif
+}
+
+/* Helper function which appends an entry to a radix heap bucket
+******************************************************************/
+static void radix_append(RadixBucket *bucket, int vertex, unsigned key) {
+
+	if (bucket->count == bucket->capacity) {
+		STATS_ADD(bytesAllocated, (long long)(bucket->capacity ? bucket->capacity : 16) * (sizeof(unsigned) + sizeof(int)));
+		bucket->capacity = bucket->capacity ? bucket->capacity * 2 : 16;
+		bucket->keys = realloc(bucket->keys, bucket->capacity * sizeof(unsigned));
+		bucket->vertices = realloc(bucket->vertices, bucket->capacity * sizeof(int));
+	}
+	bucket->keys[bucket->count] = key;
+	bucket->vertices[bucket->count] = vertex;
+	bucket->count++;
+}
+
+/* Initialises a new, empty, radix heap
+*********************************************/
+RadixHeap new_radix_heap(void) {
+
+	RadixHeap heap;
+
+	heap.size = 0;
+	heap.last = 0;
+	for (int b = 0; b < 33; b++) {
+		heap.bucket[b].count = 0;
+		heap.bucket[b].capacity = 0;
+		heap.bucket[b].keys = NULL;
+		heap.bucket[b].vertices = NULL;
+	}
+
+	return heap;
+}
+
+/* Destroys radix heap, freeing all memory
+******************************************/
+void destroy_radix_heap(RadixHeap *self) {
+	for (int b = 0; b < 33; b++) {
+		free(self->bucket[b].keys);
+		free(self->bucket[b].vertices);
+	}
+	self->size = 0;
+}
+
+/* Returns true if radix heap holds no entries
+**********************************************/
+int radix_is_empty(RadixHeap *self) {
+	return self->size == 0;
+}
+
+/* Inserts vertex with key; key must be >= the last key popped
+****************************************************************/
+void radix_push(RadixHeap *self, int vertex, unsigned key) {
+	radix_append(&self->bucket[radix_bucket(key, self->last)], vertex, key);
+	self->size++;
+	STATS_ADD(pushes, 1);
+}
+
+/* Removes an entry with smallest key
+	Returns its vertex and stores its key, or returns -1 if heap is empty
+**************************************************************************/
+int radix_pop(RadixHeap *self, unsigned *key) {
+
+	if (self->size == 0) {
+		return -1;
+	}
+
+	if (self->bucket[0].count == 0) {
+		int b = 1;									// First non-empty bucket
+		while (self->bucket[b].count == 0) {
+			b++;
+		}
+
+		RadixBucket *source = &self->bucket[b];
+		unsigned minimum = source->keys[0];
+		for (int i = 1; i < source->count; i++) {
+			minimum = source->keys[i] < minimum ? source->keys[i] : minimum;
+		}
+
+		self->last = minimum;						// Redistribute into lower buckets
+		for (int i = 0; i < source->count; i++) {
+			radix_append(&self->bucket[radix_bucket(source->keys[i], minimum)], source->vertices[i], source->keys[i]);
+		}
+		source->count = 0;
+	}
+
+	RadixBucket *bucket = &self->bucket[0];
+	bucket->count--;
+	STATS_ADD(pops, 1);
+	self->size--;
+	*key = bucket->keys[bucket->count];
+	return bucket->vertices[bucket->count];
+}
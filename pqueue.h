@@ -0,0 +1,79 @@
+#pragma once
+
+/* Indexed d-ary min-heap keyed by vertex.
+	Each vertex appears at most once; position[] lets a vertex's key be
+	decreased in place instead of pushing duplicates.
+**************************************************************************/
+typedef struct indexedHeap {
+	int arity;		// Children per node (2 = binary heap, 4 = quaternary...)
+	int size;		// Number of vertices currently in heap
+	int capacity;	// Number of vertices heap can index
+	int *heap;		// heap[i] = vertex stored at slot i
+	int *position;	// position[vertex] = slot in heap, or -1 if not in heap
+	int *key;		// key[vertex] = priority of vertex
+} IndexedHeap;
+
+// Functions for building/destroying heaps
+IndexedHeap new_heap(int capacity, int arity);
+void destroy_heap(IndexedHeap *self);
+void heap_clear(IndexedHeap *self);
+
+// Heap operations
+int heap_is_empty(IndexedHeap *self);
+int heap_contains(IndexedHeap *self, int vertex);
+void heap_push(IndexedHeap *self, int vertex, int key);
+int heap_pop(IndexedHeap *self);
+int heap_min_key(IndexedHeap *self);
+
+/* Dial's bucket queue for integer keys, where keys in the queue never span more than
+	maxWeight (true in Dijkstra with edge weights 0..maxWeight).
+	Bucket b holds vertices whose key = b (mod maxWeight + 1) in a doubly-linked list,
+	so insert, decrease-key and (amortised) extract-min are O(1).
+**************************************************************************/
+typedef struct bucketQueue {
+	int bucketCount;	// maxWeight + 1
+	int size;			// Number of vertices currently in queue
+	int current;		// Smallest key that can still be in queue
+	int *head;			// head[b] = first vertex in bucket b, or -1
+	int *next;			// next[vertex] = following vertex in same bucket, or -1
+	int *prev;			// prev[vertex] = preceding vertex in same bucket, or -1
+	int *key;			// key[vertex] = priority of vertex
+	char *queued;		// queued[vertex] = 1 if vertex is in queue
+} BucketQueue;
+
+// Functions for building/destroying bucket queues
+BucketQueue new_bucket_queue(int capacity, int maxWeight);
+void destroy_bucket_queue(BucketQueue *self);
+
+// Bucket queue operations
+int bucket_is_empty(BucketQueue *self);
+void bucket_push(BucketQueue *self, int vertex, int key);
+int bucket_pop(BucketQueue *self);
+
+/* Radix heap for non-negative integer keys which are extracted in non-decreasing order.
+	Entry with key k is kept in bucket (bit length of k XOR last extracted key), so each
+	entry moves down at most 32 buckets in its lifetime.
+	Keys are not decreased in place; a vertex may be pushed again with a smaller key, and
+	callers skip stale entries when they are popped.
+**************************************************************************/
+typedef struct radixBucket {
+	int count;
+	int capacity;
+	unsigned *keys;
+	int *vertices;
+} RadixBucket;
+
+typedef struct radixHeap {
+	int size;			// Number of entries (including stale ones)
+	unsigned last;		// Last key extracted
+	RadixBucket bucket[33];
+} RadixHeap;
+
+// Functions for building/destroying radix heaps
+RadixHeap new_radix_heap(void);
+void destroy_radix_heap(RadixHeap *self);
+
+// Radix heap operations
+int radix_is_empty(RadixHeap *self);
+void radix_push(RadixHeap *self, int vertex, unsigned key);
+int radix_pop(RadixHeap *self, unsigned *key);
@@ -0,0 +1,592 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#define read _read
+#define write _write
+#else
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+#include "service.h"
+#include "batch.h"
+#include "dem.h"
+#include "demfile.h"
+#include "johnson.h"
+#include "stats.h"
+
+// 1 if a thread can read requests while a batch is answered (needs OpenMP and poll())
+#if defined(_OPENMP) && !defined(_WIN32)
+#define SERVICE_READER 1
+#else
+#define SERVICE_READER 0
+#endif
+
+/* Everything loaded once and shared by every query
+**************************************************************************/
+typedef struct service {
+	int size;
+	int vertexCount;
+	int **dem;				// Generated DEM, or row pointers into 'file'
+	DemFile file;
+	int fromFile;
+	CsrGraph graph;
+	int ownsGraph;			// 0 if graph is stored in (and mapped from) 'file'
+	int negative;
+	JohnsonGraph reweighted;	// Non-negative copy of graph, if negative
+	CsrGraph *search;		// Graph searched: graph, or reweighted.graph
+	QueryPool pool;
+	int **paths;			// One path buffer of vertexCount entries per thread
+} Service;
+
+/* One response, built by a worker and written by the reader in request order
+**************************************************************************/
+typedef struct response {
+	unsigned char header[SERVICE_RESPONSE_BYTES];
+	unsigned char *runs;
+	int runCount;
+} Response;
+
+/* Helper functions for little-endian fields
+**************************************************************************/
+static unsigned get_u32(const unsigned char *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (unsigned)p[3] << 24;
+}
+
+static void put_u32(unsigned char *p, unsigned value) {
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+	p[2] = (unsigned char)(value >> 16);
+	p[3] = (unsigned char)(value >> 24);
+}
+
+/* Helper function which writes all of buffer, retrying short writes
+	Returns 1 on success, 0 on failure
+**************************************************************************/
+static int write_all(int fd, const unsigned char *buffer, size_t length) {
+	while (length > 0) {
+		int n = (int)write(fd, buffer, (unsigned)length);
+		if (n <= 0) {
+			return 0;
+		}
+		buffer += n;
+		length -= n;
+	}
+	return 1;
+}
+
+/* Helper function which encodes a path as runs of moves in one direction
+	Returns number of run bytes written to runs (at most length - 1)
+**************************************************************************/
+static int encode_runs(int *path, int length, int size, unsigned char *runs) {
+
+	int count = 0;
+	int last = -1;
+	int run = 0;
+
+	for (int i = 1; i < length; i++) {
+		int step = path[i] - path[i - 1];
+		int direction = step == -size ? SERVICE_NORTH : step == size ? SERVICE_SOUTH
+			: step == -1 ? SERVICE_WEST : SERVICE_EAST;
+		if (direction == last && run < 64) {
+			run++;
+			runs[count - 1] = (unsigned char)(direction | (run - 1) << 2);
+		}
+		else {
+			last = direction;
+			run = 1;
+			runs[count++] = (unsigned char)direction;
+		}
+	}
+	return count;
+}
+
+/* Helper function which answers one request
+**************************************************************************/
+static void answer(Service *self, Workspace *ws, int *path, const unsigned char *request, Response *out) {
+
+	unsigned id = get_u32(request);
+	int source = (int)get_u32(request + 4);
+	int target = (int)get_u32(request + 8);
+	unsigned flags = get_u32(request + 12);
+	unsigned status = SERVICE_OK;
+	int cost = 0;
+
+	out->runs = NULL;
+	out->runCount = 0;
+
+	if (source < 0 || source >= self->vertexCount || target < 0 || target >= self->vertexCount) {
+		status = SERVICE_BAD_REQUEST;
+	}
+	else {
+		int distance = workspace_dijkstra(self->search, ws, source, target);
+		if (distance == INT_MAX) {
+			status = SERVICE_UNREACHABLE;
+		}
+		else {
+			cost = self->negative		// Undo Johnson reweighting
+				? distance - self->reweighted.potential[source] + self->reweighted.potential[target]
+				: distance;
+			if (flags & SERVICE_WANT_PATH) {
+				int length = workspace_path(ws, target, path, self->vertexCount);
+				out->runs = malloc(length > 1 ? length - 1 : 1);
+				out->runCount = encode_runs(path, length, self->size, out->runs);
+			}
+		}
+	}
+
+	put_u32(out->header, id);
+	put_u32(out->header + 4, status);
+	put_u32(out->header + 8, (unsigned)cost);
+	put_u32(out->header + 12, (unsigned)out->runCount);
+}
+
+/* Helper function which sorts latencies for percentiles
+**************************************************************************/
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/* Requests read from a stream but not answered yet
+**************************************************************************/
+typedef struct requestQueue {
+	unsigned char *bytes;	// Complete requests, then any partial request
+	size_t have;			// Bytes in 'bytes'
+	size_t capacity;
+	double *arrived;		// stats_now() when each complete request was read
+	int arrivedCapacity;
+	int ended;				// Stream ended or failed
+} RequestQueue;
+
+/* Helper function which reads once from a stream onto the end of the queue, and
+	stamps every request it completes with the time it was read
+**************************************************************************/
+static void queue_read(RequestQueue *q, int in) {
+
+	if (q->capacity - q->have < SERVICE_MAX_BATCH * SERVICE_REQUEST_BYTES) {
+		q->capacity *= 2;
+		q->bytes = realloc(q->bytes, q->capacity);
+	}
+	int n = (int)read(in, q->bytes + q->have, (unsigned)(q->capacity - q->have));
+	if (n <= 0) {
+		q->ended = 1;
+		return;
+	}
+	double now = stats_now();
+	int before = (int)(q->have / SERVICE_REQUEST_BYTES);
+	q->have += n;
+	int after = (int)(q->have / SERVICE_REQUEST_BYTES);
+
+	if (after > q->arrivedCapacity) {
+		while (after > q->arrivedCapacity) {
+			q->arrivedCapacity *= 2;
+		}
+		q->arrived = realloc(q->arrived, q->arrivedCapacity * sizeof(double));
+	}
+	for (int i = before; i < after; i++) {
+		q->arrived[i] = now;
+	}
+}
+
+#if SERVICE_READER
+
+/* Helper function run by the reader thread while a batch is answered: keeps reading
+	the stream until 'wake' becomes readable, so requests sent meanwhile are stamped
+	when they arrive rather than when the batch is done. Stops reading (leaving the
+	rest in the stream) once SERVICE_MAX_QUEUED requests are waiting
+**************************************************************************/
+static void read_while_answering(RequestQueue *q, int in, int wake) {
+
+	struct pollfd fds[2] = { { wake, POLLIN, 0 }, { in, POLLIN, 0 } };
+	while (1) {
+		int watch = !q->ended && q->have / SERVICE_REQUEST_BYTES < SERVICE_MAX_QUEUED ? 2 : 1;
+		if (poll(fds, watch, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		if (fds[0].revents) {
+			char byte;
+			if (read(wake, &byte, 1) != 1) {
+				perror("wake reader");
+			}
+			return;
+		}
+		if (watch == 2 && fds[1].revents) {
+			queue_read(q, in);
+		}
+	}
+}
+#endif
+
+/* Helper function which answers requests from one stream until it ends
+	Takes up to SERVICE_MAX_BATCH waiting requests at a time, answers them across the
+	pool's threads, then writes the responses in order with one write. Where OpenMP
+	is available, one more thread keeps reading the stream meanwhile
+	Latency is measured per request, from when it was read to when its response was
+	written
+**************************************************************************/
+static void serve_stream(Service *self, int in, int out) {
+
+	RequestQueue queue = { NULL, 0, 4 * SERVICE_MAX_BATCH * SERVICE_REQUEST_BYTES, NULL, 4 * SERVICE_MAX_BATCH, 0 };
+	queue.bytes = malloc(queue.capacity);
+	queue.arrived = malloc(queue.arrivedCapacity * sizeof(double));
+
+	unsigned char *batch = malloc(SERVICE_MAX_BATCH * SERVICE_REQUEST_BYTES);
+	double *arrived = malloc(SERVICE_MAX_BATCH * sizeof(double));
+	Response *responses = malloc(SERVICE_MAX_BATCH * sizeof(Response));
+	size_t outCapacity = 1 << 16;
+	unsigned char *output = malloc(outCapacity);
+
+	int latencyCapacity = 1024;
+	double *latency = malloc(latencyCapacity * sizeof(double));
+	long long queries = 0;
+	double first = 0.0;
+	double last = 0.0;
+
+	int reader = SERVICE_READER;
+#if SERVICE_READER
+	int wake[2];					// Written to by the last worker to stop the reader
+	if (pipe(wake) != 0) {
+		reader = 0;
+	}
+#endif
+
+	while (1) {
+		int waiting = (int)(queue.have / SERVICE_REQUEST_BYTES);
+		if (waiting == 0) {
+			if (queue.ended) {
+				break;
+			}
+			queue_read(&queue, in);
+			continue;
+		}
+
+		// Take the oldest requests; the reader may grow the queue while they are answered
+		int count = waiting < SERVICE_MAX_BATCH ? waiting : SERVICE_MAX_BATCH;
+		memcpy(batch, queue.bytes, (size_t)count * SERVICE_REQUEST_BYTES);
+		memcpy(arrived, queue.arrived, count * sizeof(double));
+		queue.have -= (size_t)count * SERVICE_REQUEST_BYTES;
+		memmove(queue.bytes, queue.bytes + (size_t)count * SERVICE_REQUEST_BYTES, queue.have);
+		memmove(queue.arrived, queue.arrived + count, (waiting - count) * sizeof(double));
+		if (queries == 0) {
+			first = arrived[0];
+		}
+
+		int next = 0;
+		int finished = 0;
+		#pragma omp parallel num_threads(self->pool.threads + reader)
+		{
+#ifdef _OPENMP
+			int t = omp_get_thread_num();
+			int team = omp_get_num_threads();
+#else
+			int t = 0;
+			int team = 1;
+#endif
+			int workers = reader && team > 1 ? team - 1 : team;
+			if (t == workers) {
+#if SERVICE_READER
+				read_while_answering(&queue, in, wake[0]);
+#endif
+			}
+			else {
+				while (1) {				// Requests are taken one at a time, as schedule(dynamic)
+					int i;
+					#pragma omp atomic capture
+					i = next++;
+					if (i >= count) {
+						break;
+					}
+					answer(self, &self->pool.workspaces[t], self->paths[t], batch + i * SERVICE_REQUEST_BYTES, &responses[i]);
+				}
+				int done;
+				#pragma omp atomic capture
+				done = ++finished;
+#if SERVICE_READER
+				if (done == workers && workers < team && write(wake[1], "", 1) < 0) {
+					perror("wake reader");
+				}
+#else
+				(void)done;
+#endif
+			}
+		}
+
+		size_t length = 0;
+		for (int i = 0; i < count; i++) {
+			size_t bytes = SERVICE_RESPONSE_BYTES + responses[i].runCount;
+			if (length + bytes > outCapacity) {
+				while (length + bytes > outCapacity) {
+					outCapacity *= 2;
+				}
+				output = realloc(output, outCapacity);
+			}
+			memcpy(output + length, responses[i].header, SERVICE_RESPONSE_BYTES);
+			if (responses[i].runCount > 0) {
+				memcpy(output + length + SERVICE_RESPONSE_BYTES, responses[i].runs, responses[i].runCount);
+			}
+			length += bytes;
+			free(responses[i].runs);
+		}
+		int written = write_all(out, output, length);
+		last = stats_now();
+
+		if (queries + count > latencyCapacity) {
+			while (queries + count > latencyCapacity) {
+				latencyCapacity *= 2;
+			}
+			latency = realloc(latency, latencyCapacity * sizeof(double));
+		}
+		for (int i = 0; i < count; i++) {
+			latency[queries + i] = last - arrived[i];
+		}
+		queries += count;
+
+		if (!written) {
+			break;
+		}
+	}
+
+	if (queries > 0) {
+		qsort(latency, queries, sizeof(double), compare_doubles);
+		double seconds = last - first;
+		fprintf(stderr, "%lld queries in %.3f s (%.0f queries/s); latency p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			queries, seconds, seconds > 0 ? queries / seconds : 0.0,
+			latency[queries / 2] * 1e3, latency[queries * 99 / 100] * 1e3, latency[queries - 1] * 1e3);
+	}
+
+#if SERVICE_READER
+	if (reader) {
+		close(wake[0]);
+		close(wake[1]);
+	}
+#endif
+	free(queue.bytes);
+	free(queue.arrived);
+	free(batch);
+	free(arrived);
+	free(responses);
+	free(output);
+	free(latency);
+}
+
+/* Helper function which loads or generates the DEM and graph
+	Returns 1 on success, 0 on failure (with a message on stderr)
+**************************************************************************/
+static int load_service(ServiceConfig *config, Service *self) {
+
+	memset(self, 0, sizeof *self);
+	self->negative = config->negative != 0;
+
+	if (config->demPath != NULL) {
+		if (!open_dem_file(config->demPath, &self->file)) {
+			fprintf(stderr, "Cannot open DEM file %s\n", config->demPath);
+			return 0;
+		}
+		if (self->file.header->rows != self->file.header->cols) {
+			fprintf(stderr, "DEM file %s is not square\n", config->demPath);
+			close_dem_file(&self->file);
+			return 0;
+		}
+		self->fromFile = 1;
+		self->size = (int)self->file.header->rows;
+		self->dem = dem_file_rows(&self->file);
+	}
+	else {
+		self->size = config->size;
+		self->dem = make_dem_seeded(config->size, config->roughness, config->seed);
+	}
+	self->vertexCount = self->size * self->size;
+
+	DemCost wanted = self->negative ? DEM_COST_B : DEM_COST_A;
+	int useStored = self->fromFile && self->file.hasGraph && self->file.header->costModel == (uint32_t)wanted;
+	if (useStored && !dem_file_validate(&self->file)) {
+		fprintf(stderr, "Stored graph in %s is not valid; building one from its heights\n", config->demPath);
+		useStored = 0;
+	}
+	if (useStored) {
+		self->graph = self->file.graph;					// Used in place
+		self->ownsGraph = 0;
+	}
+	else {
+		self->graph = build_csr_graph_parallel(self->dem, self->size, self->negative, config->threads);
+		self->ownsGraph = 1;
+	}
+
+	self->search = &self->graph;
+	if (self->negative) {
+		if (!johnson_prepare(&self->graph, &self->reweighted)) {
+			fprintf(stderr, "Graph contains a negative cycle\n");
+			destroy_johnson_graph(&self->reweighted);
+			return 0;
+		}
+		self->search = &self->reweighted.graph;
+	}
+
+	self->pool = new_query_pool(self->vertexCount, config->threads);
+	self->paths = malloc(self->pool.threads * sizeof(int *));
+	for (int t = 0; t < self->pool.threads; t++) {
+		self->paths[t] = malloc(self->vertexCount * sizeof(int));
+	}
+	return 1;
+}
+
+/* Helper function which frees everything load_service() set up
+**************************************************************************/
+static void unload_service(Service *self) {
+
+	if (self->paths != NULL) {
+		for (int t = 0; t < self->pool.threads; t++) {
+			free(self->paths[t]);
+		}
+		free(self->paths);
+		destroy_query_pool(&self->pool);
+	}
+	if (self->negative && self->search == &self->reweighted.graph) {
+		destroy_johnson_graph(&self->reweighted);
+	}
+	if (self->ownsGraph) {
+		destroy_csr_graph(&self->graph);
+	}
+	if (self->fromFile) {
+		free(self->dem);								// Row pointers only
+		close_dem_file(&self->file);
+	}
+	else if (self->dem != NULL) {
+		free_dem(self->dem, self->size);
+	}
+}
+
+/* Runs the route service described by config
+	Serves stdin/stdout until end of input, or accepts socket clients one at a time
+	until accept() fails
+	Returns 0 on success, 1 on failure
+*********************************************************************************************/
+int run_service(ServiceConfig *config) {
+
+	Service service;
+	if (!load_service(config, &service)) {
+		unload_service(&service);
+		return 1;
+	}
+	fprintf(stderr, "Serving %dx%d DEM (%s) with %d threads\n", service.size, service.size,
+		service.negative ? "cost_funcB" : "cost_funcA", service.pool.threads);
+
+	int status = 0;
+	if (config->socketPath == NULL) {
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		serve_stream(&service, 0, 1);
+	}
+	else {
+#ifdef _WIN32
+		fprintf(stderr, "Unix domain sockets are not supported on this platform\n");
+		status = 1;
+#else
+		struct sockaddr_un address;
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		memset(&address, 0, sizeof address);
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, config->socketPath, sizeof address.sun_path - 1);
+		unlink(config->socketPath);
+
+		if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof address) != 0 || listen(listener, 8) != 0) {
+			fprintf(stderr, "Cannot listen on %s\n", config->socketPath);
+			status = 1;
+		}
+		else {
+			signal(SIGPIPE, SIG_IGN);					// A client leaving early is not fatal
+			while (1) {
+				int client = accept(listener, NULL, NULL);
+				if (client < 0) {
+					break;
+				}
+				serve_stream(&service, client, client);
+				close(client);
+			}
+			unlink(config->socketPath);
+		}
+		if (listener >= 0) {
+			close(listener);
+		}
+#endif
+	}
+
+	unload_service(&service);
+	return status;
+}
+
+/* Parses service options, then runs the service
+	Usage: --serve [--dem FILE | --size N --roughness N --seed N] [--negative]
+				   [--socket PATH] [--threads N]
+*********************************************************************************************/
+int service_main(int argc, char *argv[]) {
+
+	ServiceConfig config = {
+		NULL,			// generate a DEM
+		513,			// size
+		132,			// roughness
+		12345u,			// seed
+		0,				// cost_funcA
+		NULL,			// stdin/stdout
+		0				// threads (all cores)
+	};
+
+	for (int i = 0; i < argc; i++) {
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (strcmp(argv[i], "--negative") == 0) {
+			config.negative = 1;
+			continue;
+		}
+		if (value == NULL) {
+			fprintf(stderr, "Missing value for %s\n", argv[i]);
+			return 1;
+		}
+		if (strcmp(argv[i], "--dem") == 0) {
+			config.demPath = value;
+		}
+		else if (strcmp(argv[i], "--size") == 0) {
+			config.size = atoi(value);
+		}
+		else if (strcmp(argv[i], "--roughness") == 0) {
+			config.roughness = atoi(value);
+		}
+		else if (strcmp(argv[i], "--seed") == 0) {
+			config.seed = (unsigned)strtoul(value, NULL, 10);
+		}
+		else if (strcmp(argv[i], "--socket") == 0) {
+			config.socketPath = value;
+		}
+		else if (strcmp(argv[i], "--threads") == 0) {
+			config.threads = atoi(value);
+		}
+		else {
+			fprintf(stderr, "Usage: --serve [--dem FILE | --size N --roughness N --seed N] [--negative]\n"
+				"               [--socket PATH] [--threads N]\n");
+			return 1;
+		}
+		i++;
+	}
+	if (config.demPath == NULL && (config.size < 3 || ((config.size - 1) & (config.size - 2)) != 0)) {
+		fprintf(stderr, "DEM size must be 2^n + 1\n");
+		return 1;
+	}
+	return run_service(&config);
+}
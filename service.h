@@ -0,0 +1,66 @@
+#pragma once
+
+/* Route service: loads (or generates) a DEM and its graph once, then answers a stream
+	of binary route queries on stdin/stdout or on a Unix domain socket.
+
+	All fields are little-endian.
+
+	Request (SERVICE_REQUEST_BYTES):
+		uint32 id			Echoed in the response
+		int32  source		Vertex (x * size + y)
+		int32  target
+		uint32 flags		SERVICE_WANT_PATH to receive the path
+
+	Response (SERVICE_RESPONSE_BYTES, then runCount bytes):
+		uint32 id
+		uint32 status		SERVICE_OK, SERVICE_UNREACHABLE or SERVICE_BAD_REQUEST
+		int32  cost			Energy cost of the route (0 unless status = SERVICE_OK)
+		uint32 runCount
+		runCount bytes		Path from source as runs of moves in one direction:
+							bits 0-1 = ServiceDirection, bits 2-7 = run length - 1
+
+	Waiting requests are answered together across worker threads, and responses are
+	written in request order. While a batch is answered, one more thread keeps reading
+	(up to SERVICE_MAX_QUEUED requests ahead), so each request's latency runs from when
+	it arrived, including any wait behind earlier batches, to when its response was
+	written. Throughput and latency percentiles are reported on stderr when each input
+	stream ends.
+**************************************************************************/
+#define SERVICE_REQUEST_BYTES 16
+#define SERVICE_RESPONSE_BYTES 16
+#define SERVICE_WANT_PATH 1u
+
+// Most requests answered together
+#define SERVICE_MAX_BATCH 256
+
+// Most requests read ahead while a batch is answered; later ones wait in the stream
+#define SERVICE_MAX_QUEUED 8192
+
+enum serviceStatus {
+	SERVICE_OK,
+	SERVICE_UNREACHABLE,
+	SERVICE_BAD_REQUEST
+};
+
+typedef enum serviceDirection {
+	SERVICE_NORTH,		// x - 1
+	SERVICE_SOUTH,		// x + 1
+	SERVICE_WEST,		// y - 1
+	SERVICE_EAST		// y + 1
+} ServiceDirection;
+
+typedef struct serviceConfig {
+	const char *demPath;		// DEM file (demfile.h) to load, or NULL to generate a DEM
+	int size;					// Generated DEM size (2^n + 1), roughness and seed
+	int roughness;
+	unsigned seed;
+	int negative;				// 1 => cost_funcB (regenerative braking), 0 => cost_funcA
+	const char *socketPath;		// Unix domain socket to listen on, or NULL for stdin/stdout
+	int threads;				// <= 0 uses every available core
+} ServiceConfig;
+
+// Runs the service; returns a process exit status
+int run_service(ServiceConfig *config);
+
+// Parses service options (after --serve), then runs the service
+int service_main(int argc, char *argv[]);
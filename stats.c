@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+#ifdef DIJKSTRA_STATS
+#if defined(_MSC_VER)
+__declspec(thread) SearchStats *stats_current = NULL;
+#else
+__thread SearchStats *stats_current = NULL;
+#endif
+#endif
+
+/* Returns true if instrumentation was compiled in (-DDIJKSTRA_STATS)
+**********************************************************************/
+int stats_enabled(void) {
+#ifdef DIJKSTRA_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* Zeroes stats, and adds work done by this thread to it until stats_end()
+****************************************************************************/
+void stats_begin(SearchStats *stats) {
+	memset(stats, 0, sizeof *stats);
+#ifdef DIJKSTRA_STATS
+	stats_current = stats;
+#endif
+}
+
+/* Stops collecting statistics on this thread
+**********************************************/
+void stats_end(void) {
+#ifdef DIJKSTRA_STATS
+	stats_current = NULL;
+#endif
+}
+
+#ifdef DIJKSTRA_STATS
+/* Starts counting this thread's work inside a parallel region into 'worker' (zeroed),
+	if the thread that started the region was collecting into 'parent'
+	Returns the thread's previous stats, for stats_worker_end()
+**************************************************************************/
+SearchStats *stats_worker_begin(SearchStats *parent, SearchStats *worker) {
+	SearchStats *saved = stats_current;
+	memset(worker, 0, sizeof *worker);
+	stats_current = parent != NULL ? worker : NULL;
+	return saved;
+}
+
+/* Adds a worker's counts to 'parent', and restores the thread's previous stats
+**************************************************************************/
+void stats_worker_end(SearchStats *parent, SearchStats *worker, SearchStats *saved) {
+	if (parent != NULL) {
+		#pragma omp critical(stats_merge)
+		{
+			parent->settled += worker->settled;
+			parent->relaxed += worker->relaxed;
+			parent->improved += worker->improved;
+			parent->pushes += worker->pushes;
+			parent->pops += worker->pops;
+			parent->bytesAllocated += worker->bytesAllocated;
+			parent->buildSeconds += worker->buildSeconds;
+			parent->searchSeconds += worker->searchSeconds;
+			parent->pathSeconds += worker->pathSeconds;
+		}
+	}
+	stats_current = saved;
+}
+#endif
+
+/* Returns seconds from an arbitrary fixed point (monotonic where available)
+******************************************************************************/
+double stats_now(void) {
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* Prints statistics under a title
+***********************************/
+void print_stats(const char *title, SearchStats *stats) {
+	printf("%s:\n", title);
+	if (!stats_enabled()) {
+		printf("  (statistics not compiled in; build with -DDIJKSTRA_STATS)\n");
+		return;
+	}
+	printf("  vertices settled     %lld\n", stats->settled);
+	printf("  edges relaxed        %lld\n", stats->relaxed);
+	printf("  distances improved   %lld\n", stats->improved);
+	printf("  queue pushes / pops  %lld / %lld\n", stats->pushes, stats->pops);
+	printf("  bytes allocated      %lld\n", stats->bytesAllocated);
+	printf("  graph build          %.3f ms\n", stats->buildSeconds * 1e3);
+	printf("  search               %.3f ms\n", stats->searchSeconds * 1e3);
+	printf("  path reconstruction  %.3f ms\n", stats->pathSeconds * 1e3);
+}
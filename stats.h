@@ -0,0 +1,62 @@
+#pragma once
+
+/* Work and time spent by graph building, searches and path reconstruction.
+	Instrumentation is compiled in only with -DDIJKSTRA_STATS; otherwise every STATS_
+	macro below expands to nothing, and stats_begin() collects nothing (all zero).
+
+	Counters are kept per thread: between stats_begin(&stats) and stats_end(), work
+	done by the calling thread is added to 'stats'. Parallel solvers count their OpenMP
+	worker threads too: before the region, STATS_PARENT(parent) takes the caller's
+	stats; inside it, each thread brackets its work with STATS_WORKER_BEGIN(parent) and
+	STATS_WORKER_END(parent), which count into a private SearchStats and add it to the
+	caller's when the thread is done. Times from worker threads are summed, so search
+	time inside a parallel solver is thread time, not elapsed time.
+**************************************************************************/
+typedef struct searchStats {
+	long long settled;			// Vertices removed from a queue and finalised
+	long long relaxed;			// Edges (or Floyd-Warshall triples) examined
+	long long improved;			// Relaxations which shortened a distance
+	long long pushes;			// Queue inserts and decrease-keys
+	long long pops;
+	long long bytesAllocated;	// By graphs, queues and solver scratch arrays
+	double buildSeconds;		// Graph building
+	double searchSeconds;		// Shortest path algorithms
+	double pathSeconds;			// Path reconstruction
+} SearchStats;
+
+// Functions for collecting/printing statistics
+int stats_enabled(void);
+void stats_begin(SearchStats *stats);
+void stats_end(void);
+double stats_now(void);
+void print_stats(const char *title, SearchStats *stats);
+
+#ifdef DIJKSTRA_STATS
+
+#if defined(_MSC_VER)
+extern __declspec(thread) SearchStats *stats_current;
+#else
+extern __thread SearchStats *stats_current;
+#endif
+
+#define STATS_ADD(field, n) do { if (stats_current) stats_current->field += (n); } while (0)
+#define STATS_TIMER_START(timer) double timer = stats_current ? stats_now() : 0.0
+#define STATS_TIMER_STOP(timer, field) do { if (stats_current) stats_current->field += stats_now() - timer; } while (0)
+
+SearchStats *stats_worker_begin(SearchStats *parent, SearchStats *worker);
+void stats_worker_end(SearchStats *parent, SearchStats *worker, SearchStats *saved);
+
+#define STATS_PARENT(parent) SearchStats *parent = stats_current
+#define STATS_WORKER_BEGIN(parent) SearchStats workerStats; SearchStats *savedStats = stats_worker_begin(parent, &workerStats)
+#define STATS_WORKER_END(parent) stats_worker_end(parent, &workerStats, savedStats)
+
+#else
+
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_TIMER_START(timer) ((void)0)
+#define STATS_TIMER_STOP(timer, field) ((void)0)
+#define STATS_PARENT(parent) ((void)0)
+#define STATS_WORKER_BEGIN(parent) ((void)0)
+#define STATS_WORKER_END(parent) ((void)0)
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <limits.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "sweep.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SWEEP_X86 1
+#include <immintrin.h>
+#endif
+
+// Distance of a vertex not reached yet; any weight can be added without overflow
+#define SWEEP_INF (INT_MAX / 2)
+
+// Transpose tile width
+#define SWEEP_TILE 32
+
+// Which neighbour a vertex's distance came from (converted to 'previous' at the end)
+enum { FROM_NONE, FROM_NORTH, FROM_SOUTH, FROM_WEST, FROM_EAST };
+
+/* Relaxes n vertices from the n neighbours in the row before them in a sweep
+	dist[j] = min(dist[j], srcDist[j] + weight[j]), recording 'code' in from[j] where it
+	improves. Returns 1 if any distance changed
+**************************************************************************/
+typedef int (*RelaxKernel)(int *dist, int *from, const int *srcDist, const int *weight, int n, int code);
+
+static int relax_scalar(int *dist, int *from, const int *srcDist, const int *weight, int n, int code) {
+	int changed = 0;
+	for (int j = 0; j < n; j++) {
+		if (srcDist[j] != SWEEP_INF && srcDist[j] + weight[j] < dist[j]) {
+			dist[j] = srcDist[j] + weight[j];
+			from[j] = code;
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+#ifdef SWEEP_X86
+__attribute__((target("sse4.1")))
+static int relax_sse41(int *dist, int *from, const int *srcDist, const int *weight, int n, int code) {
+	__m128i inf = _mm_set1_epi32(SWEEP_INF);
+	__m128i codes = _mm_set1_epi32(code);
+	__m128i any = _mm_setzero_si128();
+	int j = 0;
+	for (; j + 4 <= n; j += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(srcDist + j));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dist + j));
+		__m128i alt = _mm_add_epi32(s, _mm_loadu_si128((const __m128i *)(weight + j)));
+		__m128i better = _mm_andnot_si128(_mm_cmpeq_epi32(s, inf), _mm_cmpgt_epi32(d, alt));
+		if (!_mm_testz_si128(better, better)) {
+			__m128i f = _mm_loadu_si128((const __m128i *)(from + j));
+			_mm_storeu_si128((__m128i *)(dist + j), _mm_blendv_epi8(d, alt, better));
+			_mm_storeu_si128((__m128i *)(from + j), _mm_blendv_epi8(f, codes, better));
+			any = _mm_or_si128(any, better);
+		}
+	}
+	return relax_scalar(dist + j, from + j, srcDist + j, weight + j, n - j, code) | !_mm_testz_si128(any, any);
+}
+
+__attribute__((target("avx2")))
+static int relax_avx2(int *dist, int *from, const int *srcDist, const int *weight, int n, int code) {
+	__m256i inf = _mm256_set1_epi32(SWEEP_INF);
+	__m256i codes = _mm256_set1_epi32(code);
+	__m256i any = _mm256_setzero_si256();
+	int j = 0;
+	for (; j + 8 <= n; j += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(srcDist + j));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dist + j));
+		__m256i alt = _mm256_add_epi32(s, _mm256_loadu_si256((const __m256i *)(weight + j)));
+		__m256i better = _mm256_andnot_si256(_mm256_cmpeq_epi32(s, inf), _mm256_cmpgt_epi32(d, alt));
+		if (!_mm256_testz_si256(better, better)) {
+			__m256i f = _mm256_loadu_si256((const __m256i *)(from + j));
+			_mm256_storeu_si256((__m256i *)(dist + j), _mm256_blendv_epi8(d, alt, better));
+			_mm256_storeu_si256((__m256i *)(from + j), _mm256_blendv_epi8(f, codes, better));
+			any = _mm256_or_si256(any, better);
+		}
+	}
+	return relax_scalar(dist + j, from + j, srcDist + j, weight + j, n - j, code) | !_mm256_testz_si256(any, any);
+}
+#endif
+
+/* Helper function which picks the widest kernel this CPU supports
+**************************************************************************/
+static RelaxKernel select_kernel(const char **name) {
+#ifdef SWEEP_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		*name = "avx2";
+		return relax_avx2;
+	}
+	if (__builtin_cpu_supports("sse4.1")) {
+		*name = "sse4.1";
+		return relax_sse41;
+	}
+#endif
+	*name = "scalar";
+	return relax_scalar;
+}
+
+/* Name of the relaxation kernel grid_sweep() uses on this CPU
+**************************************************************/
+const char *grid_sweep_kernel(void) {
+	const char *name;
+	select_kernel(&name);
+	return name;
+}
+
+/* Helper function which transposes a rows x cols buffer into cols x rows, a tile at a time
+**************************************************************************/
+static void transpose(const int *in, int *out, int rows, int cols, int threads) {
+	#pragma omp parallel for schedule(static) num_threads(threads)
+	for (int bx = 0; bx < rows; bx += SWEEP_TILE) {
+		for (int by = 0; by < cols; by += SWEEP_TILE) {
+			int xEnd = bx + SWEEP_TILE < rows ? bx + SWEEP_TILE : rows;
+			int yEnd = by + SWEEP_TILE < cols ? by + SWEEP_TILE : cols;
+			for (int x = bx; x < xEnd; x++) {
+				for (int y = by; y < yEnd; y++) {
+					out[(size_t)y * rows + x] = in[(size_t)x * cols + y];
+				}
+			}
+		}
+	}
+}
+
+/* Helper function which runs a downwards then an upwards sweep over a rows x cols buffer
+	Columns are split into slices of whole SIMD vectors, one per thread; slices never read
+	each other's columns, so threads only meet at the end of the sweep
+	Returns 1 if any distance changed
+**************************************************************************/
+static int sweep_pair(RelaxKernel relax, int *dist, int *from, const int *weightDown, const int *weightUp,
+	int rows, int cols, int codeDown, int codeUp, int threads) {
+
+	int changed = 0;
+	int slice = ((cols + threads - 1) / threads + 7) & ~7;
+	int slices = (cols + slice - 1) / slice;
+
+	#pragma omp parallel for schedule(static) reduction(|:changed) num_threads(threads)
+	for (int s = 0; s < slices; s++) {
+		int y = s * slice;
+		int n = y + slice < cols ? slice : cols - y;
+		for (int x = 1; x < rows; x++) {			// Row x from row x - 1
+			size_t row = (size_t)x * cols + y;
+			changed |= relax(dist + row, from + row, dist + row - cols, weightDown + row - cols, n, codeDown);
+		}
+		for (int x = rows - 2; x >= 0; x--) {		// Row x from row x + 1
+			size_t row = (size_t)x * cols + y;
+			changed |= relax(dist + row, from + row, dist + row + cols, weightUp + row + cols, n, codeUp);
+		}
+	}
+	return changed;
+}
+
+/* Sweep solver over a grid graph
+	Same contract as grid_dijkstra(): fills 'distance' and 'previous' (length = rows * cols)
+	Takes thread count (<= 0 uses every available core)
+	Returns 1 on success, or 0 if a negative cycle is reachable (tables are then unspecified)
+*********************************************************************************************/
+int grid_sweep(GridGraph *self, int source, int *distance, int *previous, int threads) {
+
+#ifdef _OPENMP
+	if (threads <= 0) threads = omp_get_max_threads();
+#else
+	threads = 1;
+#endif
+
+	const char *name;
+	RelaxKernel relax = select_kernel(&name);
+	int rows = self->rows;
+	int cols = self->cols;
+	int vertexCount = self->V;
+	int *costs = self->costTable - self->minDiff;		// costs[diff] = cost(diff)
+
+	/* Edge weights by direction, laid out as the buffer each sweep reads them from:
+		south/north row-major (indexed by the source vertex), east/west transposed */
+	int *south = malloc(vertexCount * sizeof(int));
+	int *north = malloc(vertexCount * sizeof(int));
+	int *east = malloc(vertexCount * sizeof(int));
+	int *west = malloc(vertexCount * sizeof(int));
+	int *from = malloc(vertexCount * sizeof(int));
+	int *distT = malloc(vertexCount * sizeof(int));
+	int *fromT = malloc(vertexCount * sizeof(int));
+
+	#pragma omp parallel for schedule(static) num_threads(threads)
+	for (int x = 0; x < rows; x++) {
+		for (int y = 0; y < cols; y++) {
+			int h = self->height[x][y];
+			size_t v = (size_t)x * cols + y;
+			size_t t = (size_t)y * rows + x;
+			south[v] = x + 1 < rows ? costs[self->height[x + 1][y] - h] : 0;
+			north[v] = x > 0 ? costs[self->height[x - 1][y] - h] : 0;
+			east[t] = y + 1 < cols ? costs[self->height[x][y + 1] - h] : 0;
+			west[t] = y > 0 ? costs[self->height[x][y - 1] - h] : 0;
+			distance[v] = SWEEP_INF;
+			from[v] = FROM_NONE;
+		}
+	}
+	distance[source] = 0;
+
+	// Without negative cycles every shortest path is found within |V| - 1 passes
+	int changed = 1;
+	for (int pass = 0; changed && pass < vertexCount; pass++) {
+		changed = sweep_pair(relax, distance, from, south, north, rows, cols, FROM_NORTH, FROM_SOUTH, threads);
+		transpose(distance, distT, rows, cols, threads);
+		transpose(from, fromT, rows, cols, threads);
+		changed |= sweep_pair(relax, distT, fromT, east, west, cols, rows, FROM_WEST, FROM_EAST, threads);
+		transpose(distT, distance, cols, rows, threads);
+		transpose(fromT, from, cols, rows, threads);
+	}
+
+	int offset[] = { 0, -cols, cols, -1, 1 };			// Indexed by FROM_ codes
+	#pragma omp parallel for schedule(static) num_threads(threads)
+	for (int v = 0; v < vertexCount; v++) {
+		previous[v] = from[v] == FROM_NONE ? -1 : v + offset[from[v]];
+		distance[v] = distance[v] == SWEEP_INF ? INT_MAX : distance[v];
+	}
+
+	free(south);
+	free(north);
+	free(east);
+	free(west);
+	free(from);
+	free(distT);
+	free(fromT);
+	return !changed;
+}
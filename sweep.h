@@ -0,0 +1,23 @@
+#pragma once
+#include "grid.h"
+
+/* Sweep solver for grid graphs.
+	Instead of a priority queue, every vertex is relaxed from its North, South, West and
+	East neighbours in four sweeps (downwards, upwards, rightwards, leftwards), repeated
+	until a pass changes nothing. Each sweep relaxes a whole row from the row before it,
+	so it runs as SIMD compare/blend over contiguous memory. Horizontal sweeps work on
+	a transposed copy of the distances, so they are vertical sweeps too.
+
+	As Bellman-Ford, negative weights (e.g. cost_funcB) are allowed; a pass which
+	still changes distances after |V| passes means there is a negative cycle.
+
+	The kernel (AVX2, SSE4.1 or scalar) is chosen at runtime from what the CPU
+	supports; grid_sweep_kernel() names it.
+**************************************************************************/
+
+// Single source shortest paths; same contract as grid_dijkstra(), plus a thread count
+// (<= 0 uses every available core). Returns 1 on success, 0 on a negative cycle
+int grid_sweep(GridGraph *self, int source, int* distance, int* previous, int threads);
+
+// Name of the relaxation kernel grid_sweep() uses on this CPU
+const char *grid_sweep_kernel(void);
@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "treecache.h"
+
+#define PREVIOUS_NONE 0			// Compressed previous codes
+#define PREVIOUS_RAW 255		// Followed by 4-byte vertex
+
+/* Locking helpers (no-ops without OpenMP)
+*******************************************/
+static void cache_lock(TreeCache *self) {
+#ifdef _OPENMP
+	omp_set_lock(&self->lock);
+#else
+	(void)self;
+#endif
+}
+
+static void cache_unlock(TreeCache *self) {
+#ifdef _OPENMP
+	omp_unset_lock(&self->lock);
+#else
+	(void)self;
+#endif
+}
+
+/* Initialises a new, empty, cache
+	Takes memory budget in bytes, and whether to compress stored trees
+*********************************************/
+TreeCache new_tree_cache(size_t budget, int compress) {
+
+	TreeCache cache;
+
+	cache.budget = budget;
+	cache.used = 0;
+	cache.compress = compress;
+	cache.count = 0;
+	cache.hits = 0;
+	cache.misses = 0;
+	cache.newest = NULL;
+	cache.oldest = NULL;
+#ifdef _OPENMP
+	omp_init_lock(&cache.lock);
+#endif
+
+	return cache;
+}
+
+/* Destroys cache, freeing all memory
+******************************************/
+void destroy_tree_cache(TreeCache *self) {
+	CachedTree *tree = self->newest;
+	while (tree != NULL) {
+		CachedTree *older = tree->older;
+		free(tree->data);
+		free(tree);
+		tree = older;
+	}
+	self->newest = self->oldest = NULL;
+	self->used = 0;
+	self->count = 0;
+#ifdef _OPENMP
+	omp_destroy_lock(&self->lock);
+#endif
+}
+
+/* List helpers; trees are kept newest (most recently used) first
+*******************************************************************/
+static void unlink_tree(TreeCache *self, CachedTree *tree) {
+	if (tree->newer != NULL) {
+		tree->newer->older = tree->older;
+	}
+	else {
+		self->newest = tree->older;
+	}
+	if (tree->older != NULL) {
+		tree->older->newer = tree->newer;
+	}
+	else {
+		self->oldest = tree->newer;
+	}
+}
+
+static void push_newest(TreeCache *self, CachedTree *tree) {
+	tree->newer = NULL;
+	tree->older = self->newest;
+	if (self->newest != NULL) {
+		self->newest->newer = tree;
+	}
+	else {
+		self->oldest = tree;
+	}
+	self->newest = tree;
+}
+
+static CachedTree *find_tree(TreeCache *self, CsrGraph *graph, int costModel, int source) {
+	for (CachedTree *tree = self->newest; tree != NULL; tree = tree->older) {
+		if (tree->version == graph->version && tree->costModel == costModel && tree->source == source) {
+			return tree;
+		}
+	}
+	return NULL;
+}
+
+/* Compression helpers
+************************/
+static size_t put_varint(unsigned char *out, unsigned long long value) {
+	size_t n = 0;
+	while (value >= 0x80) {
+		out[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (unsigned char)value;
+	return n;
+}
+
+static size_t get_varint(const unsigned char *in, unsigned long long *value) {
+	size_t n = 0;
+	int shift = 0;
+	*value = 0;
+	do {
+		*value |= (unsigned long long)(in[n] & 0x7f) << shift;
+		shift += 7;
+	} while (in[n++] & 0x80);
+	return n;
+}
+
+/* Helper function which compresses a tree
+	Returns buffer (caller frees), and sets *bytes to its size
+**************************************************************************/
+static unsigned char *compress_tree(CsrGraph *graph, int *distance, int *previous, size_t *bytes) {
+
+	int vertexCount = graph->V;
+	unsigned char *out = malloc((size_t)vertexCount * 15);		// Worst case: 10 + 5 bytes
+	size_t n = 0;
+	long long last = 0;
+
+	for (int v = 0; v < vertexCount; v++) {					// Distances: zigzag deltas
+		long long delta = (long long)distance[v] - last;
+		n += put_varint(out + n, delta < 0 ? ((unsigned long long)(-delta) << 1) - 1 : (unsigned long long)delta << 1);
+		last = distance[v];
+	}
+
+	for (int v = 0; v < vertexCount; v++) {					// Previous: edge position
+		int code = PREVIOUS_RAW;
+		if (previous[v] == -1) {
+			code = PREVIOUS_NONE;
+		}
+		else {
+			int degree = graph->offsets[v + 1] - graph->offsets[v];
+			for (int k = 0; k < degree && k + 1 < PREVIOUS_RAW; k++) {
+				if (graph->to_vertex[graph->offsets[v] + k] == previous[v]) {
+					code = k + 1;
+					break;
+				}
+			}
+		}
+		out[n++] = (unsigned char)code;
+		if (code == PREVIOUS_RAW) {
+			memcpy(out + n, &previous[v], sizeof(int));
+			n += sizeof(int);
+		}
+	}
+
+	*bytes = n;
+	return realloc(out, n);
+}
+
+static void decompress_tree(CsrGraph *graph, const unsigned char *in, int *distance, int *previous) {
+
+	int vertexCount = graph->V;
+	size_t n = 0;
+	long long last = 0;
+
+	for (int v = 0; v < vertexCount; v++) {
+		unsigned long long zigzag;
+		n += get_varint(in + n, &zigzag);
+		last += (zigzag & 1) ? -(long long)((zigzag + 1) >> 1) : (long long)(zigzag >> 1);
+		distance[v] = (int)last;
+	}
+
+	for (int v = 0; v < vertexCount; v++) {
+		int code = in[n++];
+		if (code == PREVIOUS_NONE) {
+			previous[v] = -1;
+		}
+		else if (code == PREVIOUS_RAW) {
+			memcpy(&previous[v], in + n, sizeof(int));
+			n += sizeof(int);
+		}
+		else {
+			previous[v] = graph->to_vertex[graph->offsets[v] + code - 1];
+		}
+	}
+}
+
+/* Looks up the tree from source on this version of graph
+	Returns 1 and fills distance/previous if cached, or returns 0
+*********************************************************************************************/
+int tree_cache_lookup(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous) {
+
+	size_t table = (size_t)graph->V * sizeof(int);
+
+	cache_lock(self);
+	CachedTree *tree = find_tree(self, graph, costModel, source);
+	if (tree == NULL) {
+		self->misses++;
+		cache_unlock(self);
+		return 0;
+	}
+	self->hits++;
+	unlink_tree(self, tree);
+	push_newest(self, tree);
+
+	if (tree->compressed) {
+		decompress_tree(graph, tree->data, distance, previous);
+	}
+	else {
+		memcpy(distance, tree->data, table);
+		memcpy(previous, tree->data + table, table);
+	}
+	cache_unlock(self);
+	return 1;
+}
+
+/* Stores the tree from source on this version of graph, evicting least recently
+	used trees to stay within budget (a tree larger than the budget is not stored)
+*********************************************************************************************/
+void tree_cache_store(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous) {
+
+	size_t table = (size_t)graph->V * sizeof(int);
+	size_t bytes;
+	unsigned char *data;
+
+	if (self->compress) {								// Compress outside the lock
+		data = compress_tree(graph, distance, previous, &bytes);
+	}
+	else {
+		bytes = 2 * table;
+		data = malloc(bytes);
+		memcpy(data, distance, table);
+		memcpy(data + table, previous, table);
+	}
+	bytes += sizeof(CachedTree);
+
+	cache_lock(self);
+	if (bytes > self->budget || find_tree(self, graph, costModel, source) != NULL) {
+		cache_unlock(self);
+		free(data);
+		return;
+	}
+	while (self->used + bytes > self->budget) {
+		CachedTree *victim = self->oldest;
+		unlink_tree(self, victim);
+		self->used -= victim->bytes + sizeof(CachedTree);
+		self->count--;
+		free(victim->data);
+		free(victim);
+	}
+
+	CachedTree *tree = malloc(sizeof(CachedTree));
+	tree->version = graph->version;
+	tree->costModel = costModel;
+	tree->source = source;
+	tree->V = graph->V;
+	tree->compressed = self->compress;
+	tree->bytes = bytes - sizeof(CachedTree);
+	tree->data = data;
+	push_newest(self, tree);
+	self->used += bytes;
+	self->count++;
+	cache_unlock(self);
+}
+
+/* Dijkstra's Shortest Path through the cache
+	Fills distance/previous as dijkstra_csr() does, from the cache if possible
+	Returns 1 if the tree was cached, 0 if it was computed (and is now cached)
+*********************************************************************************************/
+int tree_cache_dijkstra(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous) {
+
+	if (tree_cache_lookup(self, graph, costModel, source, distance, previous)) {
+		return 1;
+	}
+	dijkstra_csr(graph, source, distance, previous);
+	tree_cache_store(self, graph, costModel, source, distance, previous);
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "graph.h"
+
+/* One cached shortest path tree.
+	Compressed trees store, per vertex, previous as its position in the vertex's own
+	edge list (1 byte when the edge back exists) and distance as a variable-length
+	difference from the vertex before it.
+**************************************************************************/
+typedef struct cachedTree {
+	unsigned long long version;		// CsrGraph version the tree was computed on
+	int costModel;
+	int source;
+	int V;
+	int compressed;
+	size_t bytes;					// Size of data
+	unsigned char *data;			// distance then previous (V ints each), or compressed
+	struct cachedTree *newer;		// Towards the most recently used tree
+	struct cachedTree *older;
+} CachedTree;
+
+/* Least recently used cache of dijkstra_csr() results, keyed by
+	(graph version, cost model, source).
+	A graph's version changes whenever its weights are changed in place (see
+	csr_mark_changed()), so trees for an edited graph are never returned; they are
+	evicted as the least recently used once the memory budget is reached.
+	Safe to share between threads.
+**************************************************************************/
+typedef struct treeCache {
+	size_t budget;					// Bytes of trees to hold at most
+	size_t used;
+	int compress;					// 1 = store trees compressed
+	int count;
+	long hits;
+	long misses;
+	CachedTree *newest;
+	CachedTree *oldest;
+#ifdef _OPENMP
+	omp_lock_t lock;
+#endif
+} TreeCache;
+
+// Functions for building/destroying caches
+TreeCache new_tree_cache(size_t budget, int compress);
+void destroy_tree_cache(TreeCache *self);
+
+// Cache operations; costModel is any caller-chosen label (e.g. a DemCost)
+int tree_cache_lookup(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous);
+void tree_cache_store(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous);
+int tree_cache_dijkstra(TreeCache *self, CsrGraph *graph, int costModel, int source, int* distance, int* previous);